@@ -0,0 +1,214 @@
+/*
+MIT License
+
+Copyright (c) 2024 Ragnar Hrafnkelsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+#if defined (__linux__)
+ #include <sys/mman.h>
+#endif
+
+// Default allocator for plan storage, aligned for the widest SIMD loads
+template <typename T, size_t Alignment = 64>
+class FFTAlignedAllocator
+{
+public:
+    //==========================================================================
+    using value_type = T;
+
+    template <typename U>
+    struct rebind { using other = FFTAlignedAllocator<U, Alignment>; };
+
+    FFTAlignedAllocator() noexcept = default;
+
+    template <typename U>
+    FFTAlignedAllocator (const FFTAlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate (size_t n)
+    {
+        return static_cast<T*> (::operator new (n * sizeof (T), std::align_val_t (Alignment)));
+    }
+
+    void deallocate (T* p, size_t) noexcept
+    {
+        ::operator delete (p, std::align_val_t (Alignment));
+    }
+
+    template <typename U>
+    bool operator== (const FFTAlignedAllocator<U, Alignment>&) const noexcept  { return true; }
+    template <typename U>
+    bool operator!= (const FFTAlignedAllocator<U, Alignment>&) const noexcept  { return false; }
+};
+
+// Allocator backing buffers of at least MinBytes with huge pages, to cut TLB
+// misses on very large plans. Tries hugetlbfs (MAP_HUGETLB) first and falls
+// back to a 2 MiB aligned mapping advised for transparent huge pages. Smaller
+// buffers, and platforms without mmap, use aligned operator new.
+template <typename T, size_t MinBytes = (size_t) 2 << 20>
+class FFTHugePageAllocator
+{
+public:
+    //==========================================================================
+    using value_type = T;
+
+    static constexpr size_t hugePageSize = (size_t) 2 << 20;
+
+    template <typename U>
+    struct rebind { using other = FFTHugePageAllocator<U, MinBytes>; };
+
+    FFTHugePageAllocator() noexcept = default;
+
+    template <typename U>
+    FFTHugePageAllocator (const FFTHugePageAllocator<U, MinBytes>&) noexcept {}
+
+    T* allocate (size_t n)
+    {
+        const auto numBytes = n * sizeof (T);
+
+       #if defined (__linux__)
+        if (numBytes >= MinBytes)
+            return static_cast<T*> (mapHugePages (roundUp (numBytes)));
+       #endif
+
+        return FFTAlignedAllocator<T>().allocate (n);
+    }
+
+    void deallocate (T* p, size_t n) noexcept
+    {
+        const auto numBytes = n * sizeof (T);
+
+       #if defined (__linux__)
+        if (numBytes >= MinBytes)
+        {
+            munmap (p, roundUp (numBytes));
+            return;
+        }
+       #endif
+
+        FFTAlignedAllocator<T>().deallocate (p, n);
+    }
+
+    template <typename U>
+    bool operator== (const FFTHugePageAllocator<U, MinBytes>&) const noexcept  { return true; }
+    template <typename U>
+    bool operator!= (const FFTHugePageAllocator<U, MinBytes>&) const noexcept  { return false; }
+
+private:
+    //==========================================================================
+    static size_t roundUp (size_t numBytes) noexcept
+    {
+        return (numBytes + hugePageSize - 1) & ~(hugePageSize - 1);
+    }
+
+   #if defined (__linux__)
+    static void* mapHugePages (size_t numBytes)
+    {
+       #if defined (MAP_HUGETLB)
+        auto* hugetlb = mmap (nullptr, numBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+        if (hugetlb != MAP_FAILED)
+            return hugetlb;
+       #endif
+
+        // No reserved huge pages, map with slack and trim to a 2 MiB boundary
+        // so the kernel can back the range with transparent huge pages
+        auto* mapped = mmap (nullptr, numBytes + hugePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (mapped == MAP_FAILED)
+            throw std::bad_alloc();
+
+        auto* begin   = static_cast<char*> (mapped);
+        auto* aligned = reinterpret_cast<char*> (((uintptr_t) begin + hugePageSize - 1) & ~(uintptr_t) (hugePageSize - 1));
+
+        if (aligned != begin)
+            munmap (begin, (size_t) (aligned - begin));
+
+        munmap (aligned + numBytes, (size_t) (begin + hugePageSize - aligned));
+
+       #if defined (MADV_HUGEPAGE)
+        madvise (aligned, numBytes, MADV_HUGEPAGE);
+       #endif
+
+        return aligned;
+    }
+   #endif
+};
+
+// Single allocation holding all of a plan's buffers. Buffers are reserved
+// up front and addressed by byte offset, so copies of a plan stay valid.
+// A plan nested in another, like FFTReal's inner FFTComplex, reserves its
+// buffers in the owner's block and reads them through a view of it, which
+// the owner points at its bytes once allocated and again in its copies.
+template <typename Allocator>
+class FFTBlock
+{
+public:
+    //==========================================================================
+    static constexpr size_t alignment = 64;
+
+    FFTBlock (const Allocator& allocator)
+      : bytes (ByteAllocator (allocator)) {}
+
+    // A copy of a view still reads the original owner until view() is called
+    FFTBlock (const FFTBlock& other)
+      : bytes (other.bytes), numBytes (other.numBytes), data (other.isView() ? other.data : bytes.data()) {}
+    FFTBlock (FFTBlock&& other) noexcept
+      : bytes (std::move (other.bytes)), numBytes (other.numBytes), data (other.data) {}
+    FFTBlock& operator= (const FFTBlock&) = delete;
+
+    template <typename E>
+    size_t reserve (size_t numElements) noexcept
+    {
+        const auto offset = numBytes;
+        numBytes += (numElements * sizeof (E) + alignment - 1) & ~(alignment - 1);
+        return offset;
+    }
+
+    void allocate()                                   { bytes.resize (numBytes); data = bytes.data(); }
+    void view (const FFTBlock& owner) noexcept        { data = owner.data; }
+
+    template <typename E>
+    E* get (size_t offset) noexcept                   { return reinterpret_cast<E*> (data + offset); }
+    template <typename E>
+    const E* get (size_t offset) const noexcept       { return reinterpret_cast<const E*> (data + offset); }
+
+    size_t getNumBytes() const noexcept               { return bytes.size(); }
+    Allocator getAllocator() const                    { return Allocator (bytes.get_allocator()); }
+
+private:
+    //==========================================================================
+    using ByteAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<unsigned char>;
+
+    std::vector<unsigned char, ByteAllocator> bytes;
+    size_t numBytes = 0;
+    unsigned char* data = nullptr;
+
+    bool isView() const noexcept                      { return data != bytes.data(); }
+};
@@ -0,0 +1,282 @@
+/*
+MIT License
+
+Copyright (c) 2024 Ragnar Hrafnkelsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined (__linux__)
+ #include <pthread.h>
+ #include <sched.h>
+#endif
+
+// Fixed set of worker threads running jobs in submission order. Workers can
+// be pinned to CPU sets, and jobs sent to one worker in particular so that
+// the same sub-problem keeps running on the same core and cache.
+class FFTThreadPool
+{
+public:
+    //==========================================================================
+    explicit FFTThreadPool (size_t numThreads = std::max (1u, std::thread::hardware_concurrency()))
+      : FFTThreadPool (std::vector<std::vector<int>> (numThreads)) {}
+
+    // One worker per CPU set, pinned to it on Linux. An empty set leaves its
+    // worker to the scheduler, as do other platforms.
+    explicit FFTThreadPool (const std::vector<std::vector<int>>& cpuSets)
+      : workerJobs (cpuSets.size())
+    {
+        for (size_t i = 0; i < cpuSets.size(); ++i)
+            workers.emplace_back ([this, i, cpus = cpuSets[i]] { pin (cpus); run (i); });
+    }
+
+    // Finishes the jobs already queued, then joins the workers
+    ~FFTThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            stopping = true;
+        }
+
+        wakeUp.notify_all();
+
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    FFTThreadPool (const FFTThreadPool&) = delete;
+    FFTThreadPool& operator= (const FFTThreadPool&) = delete;
+
+    size_t getNumThreads() const noexcept    { return workers.size(); }
+
+    // The future holds the job's result, or the exception it threw
+    template <typename Fn>
+    auto submit (Fn&& fn) -> std::future<decltype (fn())>
+    {
+        using Result = decltype (fn());
+
+        // std::function needs a copyable target, the task is move-only
+        auto task = std::make_shared<std::packaged_task<Result()>> (std::forward<Fn> (fn));
+        auto future = task->get_future();
+
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            jobs.emplace_back ([task] { (*task)(); });
+        }
+
+        wakeUp.notify_one();
+        return future;
+    }
+
+    // Like submit, but only worker index runs the job. Such jobs go ahead of
+    // the shared queue.
+    template <typename Fn>
+    auto submitTo (size_t index, Fn&& fn) -> std::future<decltype (fn())>
+    {
+        using Result = decltype (fn());
+
+        auto task = std::make_shared<std::packaged_task<Result()>> (std::forward<Fn> (fn));
+        auto future = task->get_future();
+
+        {
+            std::lock_guard<std::mutex> lock (mutex);
+            workerJobs[index].emplace_back ([task] { (*task)(); });
+        }
+
+        // One condition variable serves every worker, so wake them all
+        wakeUp.notify_all();
+        return future;
+    }
+
+private:
+    //==========================================================================
+    static void pin (const std::vector<int>& cpus)
+    {
+       #if defined (__linux__)
+        if (cpus.empty())
+            return;
+
+        cpu_set_t set;
+        CPU_ZERO (&set);
+
+        for (auto cpu : cpus)
+            CPU_SET (cpu, &set);
+
+        pthread_setaffinity_np (pthread_self(), sizeof (set), &set);
+       #else
+        (void) cpus;
+       #endif
+    }
+
+    void run (size_t index)
+    {
+        auto& own = workerJobs[index];
+
+        for (;;)
+        {
+            std::function<void()> job;
+
+            {
+                std::unique_lock<std::mutex> lock (mutex);
+                wakeUp.wait (lock, [&] { return stopping || ! own.empty() || ! jobs.empty(); });
+
+                auto& queue = ! own.empty() ? own : jobs;
+
+                if (queue.empty())
+                    return;
+
+                job = std::move (queue.front());
+                queue.pop_front();
+            }
+
+            job();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> jobs;
+    std::vector<std::deque<std::function<void()>>> workerJobs;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stopping = false;
+};
+
+// Runs the transforms of an FFTComplex or FFTReal plan on a thread pool.
+// Arguments are those of the plan's own forward/inverse overloads, and the
+// caller's buffers must stay valid until the job completes. A plan keeps
+// scratch state, so jobs on the same plan run one at a time; use one plan
+// per concurrent transform to spread work across the pool.
+template <typename Plan>
+class FFTAsync
+{
+public:
+    //==========================================================================
+    FFTAsync (Plan& planToUse, FFTThreadPool& poolToUse) noexcept
+      : plan (planToUse), pool (poolToUse) {}
+
+    // Waits for the jobs still queued or running, callbacks included, so a
+    // temporary FFTAsync blocks until its job is done. Not to be destroyed
+    // from one of its own callbacks.
+    ~FFTAsync()
+    {
+        std::unique_lock<std::mutex> lock (pendingMutex);
+        idle.wait (lock, [this] { return pending == 0; });
+    }
+
+    FFTAsync (const FFTAsync&) = delete;
+    FFTAsync& operator= (const FFTAsync&) = delete;
+
+    template <typename... Args>
+    std::future<void> forward (Args... args)
+    {
+        return submit ([=] (Plan& p) { p.forward (args...); });
+    }
+
+    template <typename... Args>
+    std::future<void> inverse (Args... args)
+    {
+        return submit ([=] (Plan& p) { p.inverse (args...); });
+    }
+
+    // Runs job (plan) on the pool, then onComplete (error) on the same
+    // worker. onComplete always runs, with whatever the job threw or a null
+    // std::exception_ptr if it returned.
+    template <typename Job, typename Callback>
+    void submit (Job job, Callback onComplete)
+    {
+        started();
+
+        pool.submit ([this, job, onComplete]
+        {
+            const Finished finished { *this };
+            std::exception_ptr error;
+
+            try
+            {
+                std::lock_guard<std::mutex> lock (planMutex);
+                job (plan);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            onComplete (error);
+        });
+    }
+
+    // The future holds what the job threw, if anything
+    template <typename Job>
+    std::future<void> submit (Job job)
+    {
+        started();
+
+        return pool.submit ([this, job]
+        {
+            const Finished finished { *this };
+            std::lock_guard<std::mutex> lock (planMutex);
+            job (plan);
+        });
+    }
+
+private:
+    //==========================================================================
+    // Last thing a job does with this, however it ends
+    struct Finished
+    {
+        FFTAsync& owner;
+
+        ~Finished()
+        {
+            // Notified under the lock, so the destructor can't return before
+            // we are done with the condition variable
+            std::lock_guard<std::mutex> lock (owner.pendingMutex);
+
+            if (--owner.pending == 0)
+                owner.idle.notify_all();
+        }
+    };
+
+    void started()
+    {
+        std::lock_guard<std::mutex> lock (pendingMutex);
+        ++pending;
+    }
+
+    Plan& plan;
+    FFTThreadPool& pool;
+    std::mutex planMutex;
+    std::mutex pendingMutex;
+    std::condition_variable idle;
+    size_t pending = 0;
+};
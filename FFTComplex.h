@@ -24,34 +24,295 @@ SOFTWARE.
 
 #pragma once
 
+#include <algorithm>
+#include <cassert>
 #include <complex>
+#include <cstdint>
+#include <stdexcept>
 #include <vector>
 #include <type_traits>
+#include "FFTAllocator.h"
+#include "FFTStats.h"
 
+// Plan construction options shared by FFTComplex and FFTReal
+struct FFTOptions
+{
+    // How inputs are reordered into the output ahead of the butterflies:
+    // recursive gathers them at the leaves of the recursion, precomputed
+    // does one pass through a digit-reversal table stored with the plan.
+    enum class Permutation { automatic, recursive, precomputed };
+
+    Permutation permutation = Permutation::automatic;
+
+    // How sizes with more than one prime factor are split: mixedRadix runs
+    // every factor as a stage with twiddles in between, primeFactor splits
+    // off the largest prime power with the Good-Thomas index maps, so no
+    // twiddles are needed between it and the rest. The fused leaves make
+    // mixedRadix the faster of the two for most sizes, primeFactor pays off
+    // mainly for fixed point sizes made of several odd primes (21, 35, 4620).
+    // splitRadix runs powers of two from 16 up as the conjugate-pair
+    // split-radix recursion, which always gathers its inputs recursively.
+    enum class Decomposition { mixedRadix, primeFactor, splitRadix };
+
+    Decomposition decomposition = Decomposition::mixedRadix;
+
+    // Reserve a transform-sized workspace so that FFTComplex::forward and
+    // inverse accept an output stride other than 1. The stages run in the
+    // workspace, which is then scattered into the strided output. FFTReal
+    // needs it for strided inverse output and inverseAccumulate.
+    bool stridedOutput = false;
+
+    // Output scaling, fused into a pass the transform makes anyway: none,
+    // 1/N on inverse, 1/sqrt(N) both ways, or customScale on inverse.
+    // Floating point only, fixed point plans already scale down by the
+    // radix at every stage.
+    enum class Normalization { none, inverse, unitary, custom };
+
+    Normalization normalization = Normalization::none;
+    double customScale = 1;
+
+    // Analysis window precomputed by FFTReal, see FFTReal::getWindow()
+    enum class Window { none, hann, hamming, blackmanHarris, kaiser };
+
+    Window window = Window::none;
+    double kaiserBeta = 8.6;
+
+    double getScale (size_t size, bool inverse) const
+    {
+        switch (normalization)
+        {
+            case Normalization::inverse: return inverse ? 1.0 / (double) size : 1.0;
+            case Normalization::unitary: return 1.0 / std::sqrt ((double) size);
+            case Normalization::custom:  return inverse ? customScale : 1.0;
+            default:                     return 1.0;
+        }
+    }
+};
+
+// Complex samples read out of an array of T: sample i has its real part at
+// data[i * step] and its imaginary part imag elements after it. Covers
+// interleaved complex input at any stride as well as strided real input,
+// whose even and odd samples make up the real and imaginary parts.
+template <typename T>
+struct FFTSource
+{
+    const T* data;
+    size_t step, imag;
+
+    std::complex<T> operator[] (size_t i) const   { return { data[i * step], data[i * step + imag] }; }
+    FFTSource operator+ (size_t i) const          { return { data + i * step, step, imag }; }
+};
+
+// Where a transform puts its result, addressed like FFTSource. Anything but
+// contiguous complex output is written from the workspace once the stages
+// are done.
+template <typename T>
+struct FFTSink
+{
+    T* data;
+    size_t step, imag;
+
+    std::complex<T>* contiguous() const noexcept
+    {
+        return step == 2 && imag == 1 ? reinterpret_cast<std::complex<T>*> (data) : nullptr;
+    }
+
+    void write (const std::complex<T>* result, size_t size) const
+    {
+        auto* output = data;
+
+        for (size_t j = 0; j < size; ++j, output += step)
+        {
+            output[0]    = result[j].real();
+            output[imag] = result[j].imag();
+        }
+    }
+};
+
+// Source read through an index table, sample i being source[index[i]]
+template <typename Source>
+struct FFTIndexedSource
+{
+    Source source;
+    const uint32_t* index;
+
+    auto operator[] (size_t i) const                 { return source[index[i]]; }
+    FFTIndexedSource operator+ (size_t i) const      { return { source, index + i }; }
+};
+
+// Sink scattering result j to data[index[j]]
 template <typename T>
+struct FFTIndexedSink
+{
+    std::complex<T>* data;
+    const uint32_t* index;
+
+    std::complex<T>* contiguous() const noexcept     { return nullptr; }
+
+    void write (const std::complex<T>* result, size_t size) const
+    {
+        for (size_t j = 0; j < size; ++j)
+            data[index[j]] = result[j];
+    }
+};
+
+// Source indexed modulo a power of two size, for the x[4m - 1] inputs of
+// the conjugate-pair split-radix recursion
+template <typename Source>
+struct FFTCyclicSource
+{
+    Source source;
+    size_t offset, mask;
+
+    auto operator[] (size_t i) const                 { return source[(offset + i) & mask]; }
+    FFTCyclicSource operator+ (size_t i) const       { return { source, offset + i, mask }; }
+};
+
+template <typename T, typename Allocator = FFTAlignedAllocator<std::complex<T>>>
 class FFTComplex
 {
 public:
     //==========================================================================
-    FFTComplex (size_t size);
+    FFTComplex (size_t size, const FFTOptions& options = {}, const Allocator& allocator = Allocator());
+
+    // Copies get their own tables, moves take them over
+    FFTComplex (const FFTComplex&);
+    FFTComplex (FFTComplex&&) = default;
 
-    void forward (const T* timeData, std::complex<T>* freqData);
-    void inverse (const std::complex<T>* freqData, T* timeData);
+    // Strides count complex samples, so channel c of an interleaved buffer
+    // holding n channels is transformed with data + c and a stride of n.
+    // Output strides other than 1 need FFTOptions::stridedOutput, without
+    // it they throw std::invalid_argument.
+    void forward (const T* timeData, std::complex<T>* freqData, size_t inStride = 1, size_t outStride = 1);
+    void inverse (const std::complex<T>* freqData, T* timeData, size_t inStride = 1, size_t outStride = 1);
 
     size_t getSize() const noexcept      { return size; }
 
+    // Factorization, kernels, memory footprint and cost estimates of the plan
+    FFTPlanStats getStats() const;
+    std::string describe() const         { return getStats().toString(); }
+
+#if FFTPP_INSTRUMENTATION
+    // Cycles and calls accumulated since construction or the last reset. A
+    // prime-factor plan counts its sub-plans' stages in getStats() order.
+    const FFTProfile& getProfile() const noexcept    { return profile; }
+    void resetProfile() noexcept                     { profile = {}; }
+#endif
+
 protected:
     //==========================================================================
-    struct Factor { size_t radix, length; };
+    template <typename, typename> friend class FFTReal;
+
+    struct Factor { size_t radix, length, twiddles; };
+
+    // Nested plan, reserving its buffers in the owner's block. Once that is
+    // allocated the owner calls attach() and then fillTables(), and attach()
+    // again in each of its copies.
+    FFTComplex (size_t size, const FFTOptions&, FFTBlock<Allocator>& owner);
+    FFTComplex (size_t size, const FFTOptions&, const Allocator&, FFTBlock<Allocator>* owner);
+    void attach (const FFTBlock<Allocator>& owner) noexcept;
+    void fillTables();
+
+    static bool usesGenericKernel (size_t radix) noexcept   { return radix != 2 && radix != 4 && radix != 8 && radix != 11 && radix != 13; }
+    static double estimateFlops (size_t radix, size_t length, size_t stride);
+    static size_t largestPrimePower (size_t size) noexcept;
+    FFTPlanStats getPrimeFactorStats() const;
+    FFTPlanStats getSplitRadixStats() const;
 
-    void perform (const std::complex<T>* input, std::complex<T>* output, const size_t, int, Factor*, bool);
-    void butterfly2 (std::complex<T>* output, const size_t, const size_t, std::complex<T>*);
-    void butterfly4 (std::complex<T>* output, const size_t, const size_t, std::complex<T>*, bool);
-    void butterflyGeneric (std::complex<T>* output, const size_t, const size_t, const size_t, std::complex<T>*);
+#if FFTPP_INSTRUMENTATION
+    // Number of entries in getStats().stages, for mixed-radix and prime-factor plans
+    size_t getNumStages() const noexcept;
+    void collectSubPlanProfiles() noexcept;
+#endif
+
+    // Source is FFTSource, FFTWindowedSource, FFTIndexedSource or
+    // FFTCyclicSource, Sink FFTSink, FFTIndexedSink or FFTOverlapAddSink
+    template <typename Source, typename Sink>
+    void transform (const Source& input, const Sink& output, bool);
+    template <typename Source>
+    void perform (Source input, std::complex<T>* output, const size_t, Factor*, bool);
+    template <typename Source>
+    void performPermuted (const Source& input, std::complex<T>* output, bool);
+    template <typename Source>
+    void permute (const Source& input, std::complex<T>* output);
+    template <typename Source>
+    void performPrimeFactor (const Source& input, std::complex<T>* output, bool);
+    template <typename Source>
+    void performSplitRadix (const Source& input, const size_t, std::complex<T>* output, const size_t, const size_t, bool);
+    void performStages (std::complex<T>* output, Factor*, bool);
+    void butterfly (const Factor&, std::complex<T>* output, bool);
+    template <typename Source>
+    void leaf (const Factor&, const Source& input, const size_t, std::complex<T>* output, bool);
+    template <typename Source>
+    void leaf2 (const Source& input, const size_t, std::complex<T>* output, const T);
+    template <typename Source>
+    void leaf4 (const Source& input, const size_t, std::complex<T>* output, const T, bool);
+    template <typename Source>
+    void leaf8 (const Source& input, const size_t, std::complex<T>* output, const T, bool);
+    template <size_t Radix, typename Source>
+    void leafPrime (const Source& input, const size_t, std::complex<T>* output, const T, bool);
+    template <typename Source>
+    void leafGeneric (const Source& input, const size_t, std::complex<T>* output, const size_t, const std::complex<T>*, const T, bool);
+    void butterfly2 (std::complex<T>* output, const size_t, const std::complex<T>*, bool);
+    void butterfly4 (std::complex<T>* output, const size_t, const std::complex<T>*, bool);
+    template <size_t Radix>
+    void butterflyPrime (std::complex<T>* output, const size_t, const std::complex<T>*, bool);
+    void butterflySplitRadix (std::complex<T>* output, const size_t, const std::complex<T>*, bool);
+
+    // For FFTReal to fuse its split pass into the last stage: when the plan
+    // ends in a radix-2 or radix-4 butterfly, performAllButLast() runs the
+    // stages before it and butterflyColumn() runs its iteration u out of
+    // place, twiddles being null for u = 0.
+    bool hasLastStage() const noexcept
+    {
+        return primeFactorPlans.empty() && ! useSplitRadix && factors[0].length > 1
+                 && (factors[0].radix == 2 || factors[0].radix == 4);
+    }
+    template <typename Source>
+    void performAllButLast (const Source& input, std::complex<T>* output, bool);
+    template <size_t Radix>
+    static void butterflyColumn (const std::complex<T>* input, const size_t, const std::complex<T>*, std::complex<T>* column, bool);
+
+    void butterflyGeneric (std::complex<T>* output, const size_t, const size_t, const std::complex<T>*, bool);
 
     const size_t size;
     Factor factors[32];
-    std::vector<std::complex<T>> twiddlesFwd, twiddlesInv;
+
+    // Forward twiddles only, the inverse transform conjugates them on the fly.
+    // Each factor owns a contiguous run at block offset Factor::twiddles, laid
+    // out in the order its butterfly reads them (w1, w2, w3... per iteration),
+    // followed by the radix roots of unity for the generic kernels. Leaves
+    // only multiply by 1 and store no twiddles.
+    // The digit-reversal table, if any, follows the twiddles, then the
+    // workspace for strided output. A nested plan's buffers run from
+    // beginOffset to endOffset of its owner's block, block being a view.
+    FFTBlock<Allocator> block;
+    size_t beginOffset, permutationOffset, workspaceOffset, endOffset;
+    bool usePermutation;
+
+    // Good-Thomas plans own no factors or twiddles: they run n2 transforms
+    // of the prime power n1 (primeFactorPlans[0]) gathered through the input
+    // map into the scratch rows, then n1 of size n2 down its columns
+    // (primeFactorPlans[1], split further if n2 allows) scattered through
+    // the output map. The sub-plans are nested in the same block, ahead of
+    // the maps and scratch.
+    using PlanAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<FFTComplex>;
+
+    std::vector<FFTComplex, PlanAllocator> primeFactorPlans;
+    size_t inputMapOffset, outputMapOffset, scratchOffset;
+
+    // Split-radix plans own no factors either. Each sub-transform size n
+    // from size down to 16 has its n/4 twiddles w^k = e^(-2 pi i k / n) at
+    // entry (size - n) / 2 of the table at splitRadixOffset.
+    bool useSplitRadix;
+    size_t splitRadixOffset;
+
+    // FFTOptions::normalization, applied by the leaves as they load
+    T forwardScale, inverseScale;
+
+#if FFTPP_INSTRUMENTATION
+    FFTProfile profile;
+#endif
 };
 
 
@@ -71,6 +332,11 @@ template <typename T>
 constexpr bool fftpp_is_integral       = std::is_integral_v<T>;
 #endif
 
+// Smallest size for which FFTOptions::Permutation::automatic precomputes the
+// input permutation. Below it the recursive gather is as fast and the table
+// would only cost memory.
+constexpr size_t fftpp_permutation_threshold = (size_t) 1 << 18;
+
 // Scalar math functions
 template <typename T>
 T sround (T x)
@@ -127,12 +393,44 @@ T halve (T x)
 
 // Complex math functions
 template <typename T>
-static inline std::complex<T> cmul (std::complex<T>& a, std::complex<T>& b)
+static inline std::complex<T> cmul (const std::complex<T>& a, const std::complex<T>& b)
 {
     return { smul (a.real(), b.real()) - smul (a.imag(), b.imag()),
              smul (a.real(), b.imag()) + smul (a.imag(), b.real()) };
 }
 
+// a * conj (b), used to run the inverse transform off the forward twiddles
+template <typename T>
+static inline std::complex<T> cmulConj (const std::complex<T>& a, const std::complex<T>& b)
+{
+    return { smul (a.real(), b.real()) + smul (a.imag(), b.imag()),
+             smul (a.imag(), b.real()) - smul (a.real(), b.imag()) };
+}
+
+template <typename T>
+static inline std::complex<T> cmul (const std::complex<T>& a, const std::complex<T>& b, bool conjugate)
+{
+    return conjugate ? cmulConj (a, b) : cmul (a, b);
+}
+
+// Multiply by -i, or by i for the inverse transform
+template <typename T>
+static inline std::complex<T> rotate (const std::complex<T>& x, bool inverse)
+{
+    return inverse ? std::complex<T> (-x.imag(), x.real())
+                   : std::complex<T> (x.imag(), -x.real());
+}
+
+// Multiply by e^(-i pi/4), or e^(i pi/4) for the inverse transform
+template <typename T>
+static inline std::complex<T> mulEighth (const std::complex<T>& x, bool inverse)
+{
+    static const T r = scos<T> (0.785398163397448309615660845819875721);
+
+    return inverse ? std::complex<T> (smul (x.real() - x.imag(), r), smul (x.real() + x.imag(), r))
+                   : std::complex<T> (smul (x.real() + x.imag(), r), smul (x.imag() - x.real(), r));
+}
+
 template <typename T, typename D>
 static inline void cdiv (std::complex<T>& c, D d)
 {
@@ -147,21 +445,208 @@ static inline void cexp (std::complex<T>* x, P phase)
     x->imag (ssin<T> (phase));
 }
 
-//==============================================================================
+// Input to a leaf kernel, pre-scaled for fixed point like a butterfly input.
+// Floating point applies the plan's normalization instead: the transform is
+// linear, so scaling the inputs scales the outputs.
 template <typename T>
-FFTComplex<T>::FFTComplex (size_t fftSize)
-  : size (fftSize)
+static inline std::complex<T> leafLoad (std::complex<T> x, size_t radix, T scale)
 {
-    twiddlesFwd.resize (size);
-    twiddlesInv.resize (size);
+    if constexpr (fftpp_is_integral<T>)
+        cdiv (x, radix);
+    else if (scale != 1)
+        x *= scale;
 
-    const double pi = 3.141592653589793238462643383279502884197169399375105820974944;
-    const double factor = -2 * pi / size;
+    return x;
+}
+
+// FFTSource of real samples multiplied by a window as they are loaded.
+// Sample i covers window[2 * i] and window[2 * i + 1], whatever the step.
+template <typename T>
+struct FFTWindowedSource
+{
+    const T* data;
+    size_t step, imag;
+    const T* window;
+
+    std::complex<T> operator[] (size_t i) const
+    {
+        return { smul (data[i * step], window[2 * i]), smul (data[i * step + imag], window[2 * i + 1]) };
+    }
+
+    FFTWindowedSource operator+ (size_t i) const  { return { data + i * step, step, imag, window + 2 * i }; }
+};
+
+// 4-point DFT written to output[0], output[outStride]...
+template <typename T>
+static inline void dft4 (const std::complex<T>& x0, const std::complex<T>& x1, const std::complex<T>& x2, const std::complex<T>& x3,
+                         std::complex<T>* output, size_t outStride, bool inverse)
+{
+    auto a = x0 + x2;
+    auto b = x0 - x2;
+    auto c = x1 + x3;
+    auto d = rotate (x1 - x3, inverse);
+
+    output[0]             = a + c;
+    output[outStride]     = b + d;
+    output[outStride * 2] = a - c;
+    output[outStride * 3] = b - d;
+}
+
+// Naive radix-point DFT of scratch against the radix roots of unity
+template <typename T>
+static inline void dft (const std::complex<T>* scratch, std::complex<T>* output, size_t outStride, size_t radix, const std::complex<T>* roots, bool inverse)
+{
+    for (size_t q1 = 0; q1 < radix; ++q1)
+    {
+        auto sum = scratch[0];
+
+        for (size_t rootIndex = 0, q = 1; q < radix; ++q)
+        {
+            rootIndex += q1;
+
+            if (rootIndex >= radix)
+                rootIndex -= radix;
+
+            sum += cmul (scratch[q], roots[rootIndex], inverse);
+        }
+
+        output[q1 * outStride] = sum;
+    }
+}
+
+// cos and sin of 2 pi k q / Radix for k, q = 1..Radix/2
+template <typename T, size_t Radix>
+struct FFTPrimeRoots
+{
+    T cosines[Radix / 2][Radix / 2], sines[Radix / 2][Radix / 2];
+
+    FFTPrimeRoots()
+    {
+        const double pi = 3.141592653589793238462643383279502884197169399375105820974944;
+
+        for (size_t k = 0; k < Radix / 2; ++k)
+        {
+            for (size_t q = 0; q < Radix / 2; ++q)
+            {
+                const auto phase = 2 * pi * (double) (((k + 1) * (q + 1)) % Radix) / (double) Radix;
+                cosines[k][q] = scos<T> (phase);
+                sines[k][q]   = ssin<T> (phase);
+            }
+        }
+    }
+};
 
-    for (auto i = 0; i < size; ++i)
+template <typename T, size_t Radix>
+inline const FFTPrimeRoots<T, Radix> fftpp_prime_roots {};
+
+// Odd prime radix DFT over conjugate pairs: outputs k and Radix - k share
+// the cosine part of x[q] + x[Radix - q] and the sine part of x[q] - x[Radix - q],
+// so every product is a complex by a real constant, (Radix - 1)^2 real
+// multiplies against 4 Radix (Radix - 1) for dft().
+template <typename T, size_t Radix>
+static inline void dftPrime (const std::complex<T>* x, std::complex<T>* output, size_t outStride, bool inverse)
+{
+    constexpr size_t half = Radix / 2;
+    const auto& roots = fftpp_prime_roots<T, Radix>;
+
+    std::complex<T> sums[half], differences[half];
+    auto dc = x[0];
+
+    for (size_t q = 0; q < half; ++q)
+    {
+        sums[q]        = x[q + 1] + x[Radix - 1 - q];
+        differences[q] = x[q + 1] - x[Radix - 1 - q];
+        dc += sums[q];
+    }
+
+    for (size_t k = 0; k < half; ++k)
+    {
+        auto a = x[0];
+        std::complex<T> b;
+
+        for (size_t q = 0; q < half; ++q)
+        {
+            const auto c = roots.cosines[k][q];
+            const auto s = roots.sines[k][q];
+
+            a += std::complex<T> (smul (sums[q].real(), c), smul (sums[q].imag(), c));
+            b += std::complex<T> (smul (differences[q].real(), s), smul (differences[q].imag(), s));
+        }
+
+        b = rotate (b, inverse);
+
+        output[(k + 1) * outStride]         = a + b;
+        output[(Radix - 1 - k) * outStride] = a - b;
+    }
+
+    output[0] = dc;
+}
+
+//==============================================================================
+template <typename T, typename Allocator>
+FFTComplex<T, Allocator>::FFTComplex (size_t fftSize, const FFTOptions& options, const Allocator& allocator)
+  : FFTComplex (fftSize, options, allocator, nullptr)
+{
+    block.allocate();
+    attach (block);
+    fillTables();
+}
+
+template <typename T, typename Allocator>
+FFTComplex<T, Allocator>::FFTComplex (size_t fftSize, const FFTOptions& options, FFTBlock<Allocator>& owner)
+  : FFTComplex (fftSize, options, owner.getAllocator(), &owner)
+{
+}
+
+// Factorizes the size and reserves the tables, in owner's block if given,
+// leaving allocation and fillTables() to the caller
+template <typename T, typename Allocator>
+FFTComplex<T, Allocator>::FFTComplex (size_t fftSize, const FFTOptions& options, const Allocator& allocator, FFTBlock<Allocator>* owner)
+  : size (fftSize), block (allocator), primeFactorPlans (PlanAllocator (allocator)), useSplitRadix (false),
+    forwardScale (fftpp_is_floating_point<T> ? (T) options.getScale (fftSize, false) : 1),
+    inverseScale (fftpp_is_floating_point<T> ? (T) options.getScale (fftSize, true) : 1)
+{
+    auto& storage = owner != nullptr ? *owner : block;
+    beginOffset = storage.template reserve<unsigned char> (0);
+
+    if (options.decomposition == FFTOptions::Decomposition::splitRadix && size >= 16 && (size & (size - 1)) == 0)
+    {
+        useSplitRadix     = true;
+        usePermutation    = false;
+        splitRadixOffset  = storage.template reserve<std::complex<T>> (size / 2);
+        permutationOffset = storage.template reserve<uint32_t> (0);
+        workspaceOffset   = storage.template reserve<std::complex<T>> (options.stridedOutput ? size : 0);
+        endOffset         = storage.template reserve<unsigned char> (0);
+        return;
+    }
+
+    const auto n1 = largestPrimePower (size);
+
+    if (n1 != size && options.decomposition == FFTOptions::Decomposition::primeFactor)
     {
-        cexp (twiddlesFwd.data() + i, factor * i);
-        cexp (twiddlesInv.data() + i, factor * i * -1);
+        const auto n2 = size / n1;
+
+        // The first plan applies the normalization as its leaves load, the
+        // second scatters through the output map from its workspace
+        auto subOptions = options;
+        subOptions.normalization = FFTOptions::Normalization::none;
+
+        primeFactorPlans.reserve (2);
+        primeFactorPlans.push_back (FFTComplex (n1, subOptions, storage));
+        subOptions.stridedOutput = true;
+        primeFactorPlans.push_back (FFTComplex (n2, subOptions, storage));
+
+        primeFactorPlans[0].forwardScale = forwardScale;
+        primeFactorPlans[0].inverseScale = inverseScale;
+
+        usePermutation    = false;
+        inputMapOffset    = storage.template reserve<uint32_t> (size);
+        outputMapOffset   = storage.template reserve<uint32_t> (size);
+        scratchOffset     = storage.template reserve<std::complex<T>> (size);
+        permutationOffset = storage.template reserve<uint32_t> (0);
+        workspaceOffset   = storage.template reserve<std::complex<T>> (options.stridedOutput ? size : 0);
+        endOffset         = storage.template reserve<unsigned char> (0);
+        return;
     }
 
     size_t p = 4;
@@ -190,146 +675,963 @@ FFTComplex<T>::FFTComplex (size_t fftSize)
         factor.length = fftSize;
     } 
     while (fftSize > 1);
+
+    // Fold a trailing 4 x 2 into a single radix-8 leaf, saving a pass
+    if (factorsPtr - factors >= 2 && factorsPtr[-1].radix == 2 && factorsPtr[-2].radix == 4)
+    {
+        --factorsPtr;
+        factorsPtr[-1].radix  = 8;
+        factorsPtr[-1].length = 1;
+    }
+
+    for (auto* f = factors; f != factorsPtr; ++f)
+    {
+        auto numTwiddles = f->length > 1 ? (f->radix - 1) * f->length : 0;
+
+        if (usesGenericKernel (f->radix))
+            numTwiddles += f->radix;
+
+        f->twiddles = storage.template reserve<std::complex<T>> (numTwiddles);
+    }
+
+    switch (options.permutation)
+    {
+        case FFTOptions::Permutation::recursive:   usePermutation = false; break;
+        case FFTOptions::Permutation::precomputed: usePermutation = true; break;
+        default:                                   usePermutation = size >= fftpp_permutation_threshold; break;
+    }
+
+    permutationOffset = storage.template reserve<uint32_t> (usePermutation ? size : 0);
+    workspaceOffset   = storage.template reserve<std::complex<T>> (options.stridedOutput ? size : 0);
+    endOffset         = storage.template reserve<unsigned char> (0);
 }
 
-template <typename T>
-void FFTComplex<T>::forward (const T* timeData, std::complex<T>* freqData)
+template <typename T, typename Allocator>
+FFTComplex<T, Allocator>::FFTComplex (const FFTComplex& other)
+  : size (other.size), block (other.block),
+    beginOffset (other.beginOffset), permutationOffset (other.permutationOffset),
+    workspaceOffset (other.workspaceOffset), endOffset (other.endOffset), usePermutation (other.usePermutation),
+    primeFactorPlans (other.primeFactorPlans), inputMapOffset (other.inputMapOffset),
+    outputMapOffset (other.outputMapOffset), scratchOffset (other.scratchOffset),
+    useSplitRadix (other.useSplitRadix), splitRadixOffset (other.splitRadixOffset),
+    forwardScale (other.forwardScale), inverseScale (other.inverseScale)
+#if FFTPP_INSTRUMENTATION
+    , profile (other.profile)
+#endif
 {
-    perform (reinterpret_cast<const std::complex<T>*> (timeData), freqData, 1, 1, factors, false);
+    std::copy (std::begin (other.factors), std::end (other.factors), factors);
+    attach (block);
 }
 
-template <typename T>
-void FFTComplex<T>::inverse(const std::complex<T>* freqData, T* timeData)
+// Points the views of this plan and its sub-plans at owner's bytes, which
+// for a plan that owns its block is a no-op for itself
+template <typename T, typename Allocator>
+void FFTComplex<T, Allocator>::attach (const FFTBlock<Allocator>& owner) noexcept
 {
-    perform (freqData, reinterpret_cast<std::complex<T>*> (timeData), 1, 1, factors, true);
+    if (&owner != &block)
+        block.view (owner);
+
+    for (auto& plan : primeFactorPlans)
+        plan.attach (owner);
 }
 
-template <typename T>
-void FFTComplex<T>::perform (const std::complex<T>* input, std::complex<T>* output, const size_t stride, int inStride, Factor* factors, bool inverse)
+template <typename T, typename Allocator>
+void FFTComplex<T, Allocator>::fillTables()
 {
-    const auto& factor = *factors++;
-    const auto radix  = factor.radix;
-    const auto length = factor.length;
+    const double pi = 3.141592653589793238462643383279502884197169399375105820974944;
+    const double factor = -2 * pi / size;
 
-    auto* outBegin = output;
-    const auto* outEnd = outBegin + radix * length;
+    if (useSplitRadix)
+    {
+        auto* tw = block.template get<std::complex<T>> (splitRadixOffset);
 
-    if (length == 1)
+        for (size_t n = size; n >= 16; n /= 2)
+            for (size_t k = 0; k < n / 4; ++k)
+                cexp (tw++, factor * (k * (size / n)));
+
+        return;
+    }
+
+    if (! primeFactorPlans.empty())
     {
-        do
-        {
-            *output = *input;
-            input  += stride * inStride;
-        } 
-        while (++output != outEnd);
+        const auto n1 = primeFactorPlans[0].size;
+        const auto n2 = primeFactorPlans[1].size;
+
+        for (auto& plan : primeFactorPlans)
+            plan.fillTables();
+
+        // Row r reads inputs n = n2 * q + n1 * r (mod size), q = 0..n1-1.
+        // Output k lands in column k mod n1, row k mod n2 (CRT), which makes
+        // the 2D transform exactly the DFT since n1 and n2 are coprime.
+        auto* inputMap  = block.template get<uint32_t> (inputMapOffset);
+        auto* outputMap = block.template get<uint32_t> (outputMapOffset);
+
+        for (size_t r = 0; r < n2; ++r)
+            for (size_t q = 0; q < n1; ++q)
+                inputMap[r * n1 + q] = (uint32_t) ((n2 * q + n1 * r) % size);
+
+        for (size_t k = 0; k < size; ++k)
+            outputMap[(k % n1) * n2 + k % n2] = (uint32_t) k;
+
+        return;
     }
-    else
+
+    // The leaf, the one factor of length 1, ends the list
+    auto* factorsEnd = factors;
+
+    while (factorsEnd->length > 1)
+        ++factorsEnd;
+
+    ++factorsEnd;
+
+    if (usePermutation)
     {
-        do
+        // Replay the leaf order of perform(): output j reads input perm[j]
+        auto* perm = block.template get<uint32_t> (permutationOffset);
+
+        for (size_t j = 0; j < size; ++j)
         {
-            perform (input, output, stride * radix, inStride, factors, inverse);
-            input += stride * inStride;
-        } 
-        while ((output += length) != outEnd);
-    }
+            size_t index = 0, remainder = j, stride = 1;
+
+            for (const auto* f = factors; f != factorsEnd; ++f)
+            {
+                const auto digit = remainder / f->length;
+                remainder -= digit * f->length;
+                index += digit * stride;
+                stride *= f->radix;
+            }
 
-    output = outBegin;
+            perm[j] = (uint32_t) index;
+        }
+    }
 
-    auto* twiddles = inverse ? twiddlesInv.data() : twiddlesFwd.data();
+    size_t stride = 1;
 
-    switch (radix)
+    for (auto* f = factors; f != factorsEnd; ++f)
     {
-        case 2:  butterfly2 (output, stride, length, twiddles); break;
-        case 4:  butterfly4 (output, stride, length, twiddles, inverse); break;
-        default: butterflyGeneric (output, stride, radix, length, twiddles); break;
+        auto* tw = block.template get<std::complex<T>> (f->twiddles);
+
+        if (f->length > 1)
+            for (size_t k = 0; k < f->length; ++k)
+                for (size_t q = 1; q < f->radix; ++q)
+                    cexp (tw++, factor * ((stride * k * q) % size));
+
+        if (usesGenericKernel (f->radix))
+            for (size_t q = 0; q < f->radix; ++q)
+                cexp (tw++, factor * (q * (size / f->radix)));
+
+        stride *= f->radix;
     }
 }
 
-template <typename T>
-void FFTComplex<T>::butterfly2 (std::complex<T>* output, const size_t stride, const size_t length, std::complex<T>* twiddles)
+template <typename T, typename Allocator>
+size_t FFTComplex<T, Allocator>::largestPrimePower (size_t size) noexcept
 {
-    auto* output2 = output + length;
+    size_t largest = 1;
 
-    for (auto i = 0; i < length; ++i)
+    for (size_t p = 2; p * p <= size; ++p)
     {
-        if constexpr (fftpp_is_integral<T>)
-        {
-            cdiv (*output,  2);
-            cdiv (*output2, 2);
-        }
+        size_t power = 1;
 
-        auto t = cmul (*output2, *twiddles);
-        twiddles += stride;
-        
-        (*output2++) = (*output) - t;
-        (*output++) += t;
+        for (; size % p == 0; size /= p)
+            power *= p;
+
+        largest = std::max (largest, power);
     }
+
+    return std::max (largest, size);
 }
 
-template <typename T>
-void FFTComplex<T>::butterfly4 (std::complex<T>* output, const size_t stride, const size_t length, std::complex<T>* twiddles, bool inverse)
+template <typename T, typename Allocator>
+FFTPlanStats FFTComplex<T, Allocator>::getStats() const
 {
-    const auto* outEnd = output + length;
-    
-    const size_t length2 = 2 * length;
-    const size_t length3 = 3 * length;
+    if (! primeFactorPlans.empty())
+        return getPrimeFactorStats();
 
-    if constexpr (fftpp_is_integral<T>)
-    {
-        do
-        {
-            cdiv (output[length],  4);
-            cdiv (output[length2], 4);
-            cdiv (output[length3], 4);
-            cdiv (*output++, 4);
-        } 
-        while (output != outEnd);
+    if (useSplitRadix)
+        return getSplitRadixStats();
 
-        output = output - length;
-    }
+    FFTPlanStats stats;
+    stats.size = size;
 
-    std::complex<T> *tw1, *tw2, *tw3;
-    tw3 = tw2 = tw1 = twiddles;
+    size_t stride = 1;
+    const auto complexBytes = (double) (size * sizeof (std::complex<T>));
 
-    do
+    for (const auto* f = factors;; ++f)
     {
-        auto s0 = cmul (output[length],  *tw1);
-        auto s1 = cmul (output[length2], *tw2);
-        auto s2 = cmul (output[length3], *tw3);
-        auto s3 = s0 + s2;
-        auto s4 = s0 - s2;
-        auto s5 = (*output) - s1;
+        const auto last = f->length == 1;
+        const auto end  = last ? permutationOffset : f[1].twiddles;
 
-        (*output) += s1;
-        output[length2] = (*output) - s3;
-        (*output) += s3;
+        FFTStageInfo stage;
+        stage.radix  = f->radix;
+        stage.length = f->length;
+        stage.stride = stride;
+        stage.twiddleBytes = end - f->twiddles;
+        stage.flops = estimateFlops (f->radix, f->length, stride);
 
-        if (inverse)
+        switch (f->radix)
         {
-            output[length]  = { s5.real() - s4.imag(),
-                                s5.imag() + s4.real() };
-            output[length3] = { s5.real() + s4.imag(),
-                                s5.imag() - s4.real() };
+            case 2:  stage.kernel = last ? "leaf-2" : "radix-2"; break;
+            case 4:  stage.kernel = last ? "leaf-4" : "radix-4"; break;
+            case 8:  stage.kernel = "leaf-8"; break;
+            case 11: stage.kernel = last ? "leaf-11" : "radix-11"; break;
+            case 13: stage.kernel = last ? "leaf-13" : "radix-13"; break;
+            default: stage.kernel = last ? "leaf-generic" : "generic"; break;
         }
-        else
+
+        // Each stage reads and writes the whole output, and each of its
+        // stride invocations walks its own twiddle run. The leaves read the
+        // input directly.
+        stats.flops += stage.flops;
+        stats.bytesMoved += 2 * complexBytes + (double) (stride * stage.twiddleBytes);
+        stats.largestRadix = std::max (stats.largestRadix, f->radix);
+
+        if (usesGenericKernel (f->radix))
+            stats.largestGenericRadix = std::max (stats.largestGenericRadix, f->radix);
+        stats.stages.push_back (stage);
+
+        stride *= f->radix;
+
+        if (last)
+            break;
+    }
+
+    stats.buffers.push_back ({ "twiddles", permutationOffset - factors[0].twiddles });
+
+    if (usePermutation)
+    {
+        // The gather pass streams the digit-reversal table on top of a copy
+        stats.bytesMoved += 2 * complexBytes + (double) (size * sizeof (uint32_t));
+        stats.buffers.push_back ({ "permutation", workspaceOffset - permutationOffset });
+    }
+
+    if (workspaceOffset != endOffset)
+        stats.buffers.push_back ({ "workspace", endOffset - workspaceOffset });
+
+    stats.bytesAllocated = endOffset - beginOffset;
+
+    return stats;
+}
+
+template <typename T, typename Allocator>
+FFTPlanStats FFTComplex<T, Allocator>::getPrimeFactorStats() const
+{
+    FFTPlanStats stats;
+    stats.size = size;
+    stats.buffers.push_back ({ "twiddles", 0 });
+
+    size_t subPlanBytes = 0;
+
+    // Each sub-plan runs size / its size times, the stages keep counting
+    // invocations in their stride
+    for (const auto& plan : primeFactorPlans)
+    {
+        const auto count = size / plan.size;
+        const auto sub = plan.getStats();
+
+        for (auto stage : sub.stages)
+        {
+            stage.stride *= count;
+            stage.flops  *= (double) count;
+            stats.stages.push_back (stage);
+        }
+
+        stats.flops += sub.flops * (double) count;
+        stats.bytesMoved += sub.bytesMoved * (double) count;
+        stats.largestRadix = std::max (stats.largestRadix, sub.largestRadix);
+        stats.largestGenericRadix = std::max (stats.largestGenericRadix, sub.largestGenericRadix);
+        stats.buffers.front().bytes += sub.buffers.front().bytes;
+        subPlanBytes += sub.bytesAllocated - sub.buffers.front().bytes;
+    }
+
+    // Both index maps are streamed once per transform
+    stats.bytesMoved += (double) (2 * size * sizeof (uint32_t));
+
+    stats.buffers.push_back ({ "index maps", scratchOffset - inputMapOffset });
+    stats.buffers.push_back ({ "scratch", permutationOffset - scratchOffset });
+    stats.buffers.push_back ({ "sub-plans", subPlanBytes });
+
+    if (workspaceOffset != endOffset)
+        stats.buffers.push_back ({ "workspace", endOffset - workspaceOffset });
+
+    stats.bytesAllocated = endOffset - beginOffset;
+
+    return stats;
+}
+
+template <typename T, typename Allocator>
+FFTPlanStats FFTComplex<T, Allocator>::getSplitRadixStats() const
+{
+    FFTPlanStats stats;
+    stats.size = size;
+    stats.largestRadix = 8;
+
+    // Sub-transforms of size n = size >> level: n splits into one of n/2
+    // and two of n/4, down to the leaves at 8 and 4
+    size_t counts[64] = { 1 };
+    const auto complexBytes = sizeof (std::complex<T>);
+
+    for (size_t level = 0, n = size; n > 1; ++level, n /= 2)
+    {
+        if (counts[level] == 0)
+            continue;
+
+        FFTStageInfo stage;
+        stage.length = 1;
+        stage.stride = counts[level];
+
+        if (n > 8)
+        {
+            counts[level + 1] += counts[level];
+            counts[level + 2] += 2 * counts[level];
+
+            // Two complex multiplies and six complex adds per pair, bar
+            // k = 0 (no multiplies) and k = n/8 (two e^(-i pi/4))
+            stage.radix  = 4;
+            stage.length = n / 4;
+            stage.kernel = "split-radix";
+            stage.twiddleBytes = n / 4 * complexBytes;
+            stage.flops = (double) counts[level] * ((double) (n / 4 - 2) * (2 * 6 + 6 * 2) + 6 * 2 + (2 * 4 + 6 * 2));
+
+            if constexpr (fftpp_is_integral<T>)
+                stage.flops += (double) (counts[level] * n * 2);
+        }
+        else
+        {
+            stage.radix  = n;
+            stage.kernel = n == 8 ? "leaf-8" : (n == 4 ? "leaf-4" : "leaf-2");
+            stage.twiddleBytes = 0;
+            stage.flops  = estimateFlops (n, 1, counts[level]);
+        }
+
+        stats.flops += stage.flops;
+        stats.bytesMoved += (double) (counts[level] * (2 * n * complexBytes + stage.twiddleBytes));
+        stats.stages.push_back (stage);
+    }
+
+    stats.buffers.push_back ({ "twiddles", permutationOffset - splitRadixOffset });
+
+    if (workspaceOffset != endOffset)
+        stats.buffers.push_back ({ "workspace", endOffset - workspaceOffset });
+
+    stats.bytesAllocated = endOffset - beginOffset;
+
+    return stats;
+}
+
+template <typename T, typename Allocator>
+double FFTComplex<T, Allocator>::estimateFlops (size_t radix, size_t length, size_t stride)
+{
+    // Per butterfly: a complex multiply is 6 flops, a complex add 2
+    const auto count = (double) stride;
+    double flops;
+
+    // dftPrime(): the sums, differences and DC, then per output pair half
+    // complex by real products for each of the cosine and sine parts
+    const auto half = (double) (radix / 2);
+    const auto primeFlops = 2 * (double) (radix - 1) + 2 * half + half * (8 * half + 4);
+
+    if (length == 1)
+    {
+        // Leaves skip the twiddles, bar the two odd multiples of pi/4 in radix 8
+        switch (radix)
+        {
+            case 2:  flops = count * 2 * 2; break;
+            case 4:  flops = count * 8 * 2; break;
+            case 8:  flops = count * (2 * 8 * 2 + 2 * 4 + 8 * 2); break;
+            case 11:
+            case 13: flops = count * primeFlops; break;
+            default: flops = count * radix * (radix - 1) * (6 + 2); break;
+        }
+    }
+    else
+    {
+        // Iteration 0 multiplies by 1 and, for even lengths, the middle one
+        // by -i (free) and e^(-i pi/4) (4 flops)
+        const auto general = (double) (length - 1 - (length % 2 == 0 ? 1 : 0));
+        const auto middle  = length % 2 == 0 ? 1.0 : 0.0;
+
+        switch (radix)
+        {
+            case 2:  flops = count * (general * (6 + 2 * 2) + (1 + middle) * 2 * 2); break;
+            case 4:  flops = count * (general * (3 * 6 + 8 * 2) + 8 * 2 + middle * (2 * 4 + 8 * 2)); break;
+            case 11:
+            case 13: flops = count * (length * primeFlops + (double) (length - 1) * (radix - 1) * 6); break;
+            default: flops = count * length * (radix - 1) * (6 + radix * (6 + 2)); break;
+        }
+    }
+
+    // Fixed point scales every input down by the radix
+    if constexpr (fftpp_is_integral<T>)
+        flops += count * length * radix * 2;
+
+    return flops;
+}
+
+template <typename T, typename Allocator>
+void FFTComplex<T, Allocator>::forward (const T* timeData, std::complex<T>* freqData, size_t inStride, size_t outStride)
+{
+    transform (FFTSource<T> { timeData, 2 * inStride, 1 }, FFTSink<T> { reinterpret_cast<T*> (freqData), 2 * outStride, 1 }, false);
+}
+
+template <typename T, typename Allocator>
+void FFTComplex<T, Allocator>::inverse (const std::complex<T>* freqData, T* timeData, size_t inStride, size_t outStride)
+{
+    transform (FFTSource<T> { reinterpret_cast<const T*> (freqData), 2 * inStride, 1 }, FFTSink<T> { timeData, 2 * outStride, 1 }, true);
+}
+
+template <typename T, typename Allocator>
+template <typename Source, typename Sink>
+void FFTComplex<T, Allocator>::transform (const Source& input, const Sink& output, bool inverse)
+{
+    FFTPP_PROFILE_SCOPE (profile.transforms);
+
+    auto* result = output.contiguous();
+
+    if (result == nullptr)
+    {
+        // Without the workspace the stages would run past the end of the block
+        if (workspaceOffset == endOffset)
+            throw std::invalid_argument ("Strided output needs FFTOptions::stridedOutput.");
+
+        result = block.template get<std::complex<T>> (workspaceOffset);
+    }
+
+    if (! primeFactorPlans.empty())
+        performPrimeFactor (input, result, inverse);
+    else if (useSplitRadix)
+        performSplitRadix (FFTCyclicSource<Source> { input, 0, size - 1 }, 1, result, size, 0, inverse);
+    else if (usePermutation)
+        performPermuted (input, result, inverse);
+    else
+        perform (input, result, 1, factors, inverse);
+
+    if (result != output.contiguous())
+        output.write (result, size);
+}
+
+template <typename T, typename Allocator>
+template <typename Source>
+void FFTComplex<T, Allocator>::performPrimeFactor (const Source& input, std::complex<T>* output, bool inverse)
+{
+    auto& rows    = primeFactorPlans[0];
+    auto& columns = primeFactorPlans[1];
+    const auto n1 = rows.size;
+    const auto n2 = columns.size;
+
+    auto* scratch         = block.template get<std::complex<T>> (scratchOffset);
+    const auto* inputMap  = block.template get<uint32_t> (inputMapOffset);
+    const auto* outputMap = block.template get<uint32_t> (outputMapOffset);
+
+    // A prime power never splits again, so the rows go straight to the
+    // stages, which also bounds the nesting of indexed sources
+    for (size_t r = 0; r < n2; ++r)
+    {
+        const FFTIndexedSource<Source> row { input, inputMap + r * n1 };
+
+        if (rows.usePermutation)
+            rows.performPermuted (row, scratch + r * n1, inverse);
+        else
+            rows.perform (row, scratch + r * n1, 1, rows.factors, inverse);
+    }
+
+    for (size_t c = 0; c < n1; ++c)
+        columns.transform (FFTSource<T> { reinterpret_cast<const T*> (scratch + c), 2 * n1, 1 },
+                           FFTIndexedSink<T> { output, outputMap + c * n2 }, inverse);
+
+#if FFTPP_INSTRUMENTATION
+    collectSubPlanProfiles();
+#endif
+}
+
+#if FFTPP_INSTRUMENTATION
+template <typename T, typename Allocator>
+size_t FFTComplex<T, Allocator>::getNumStages() const noexcept
+{
+    if (! primeFactorPlans.empty())
+        return primeFactorPlans[0].getNumStages() + primeFactorPlans[1].getNumStages();
+
+    size_t numStages = 1;
+
+    while (factors[numStages - 1].length > 1)
+        ++numStages;
+
+    return numStages;
+}
+
+// Moves the sub-plans' counters into ours, the rows' stages first and the
+// columns' after them, as getPrimeFactorStats() lists them
+template <typename T, typename Allocator>
+void FFTComplex<T, Allocator>::collectSubPlanProfiles() noexcept
+{
+    size_t first = 0;
+
+    for (auto& plan : primeFactorPlans)
+    {
+        const auto numStages = plan.getNumStages();
+
+        for (size_t i = 0; i < numStages; ++i)
+        {
+            profile.stages[first + i].cycles += plan.profile.stages[i].cycles;
+            profile.stages[first + i].calls  += plan.profile.stages[i].calls;
+        }
+
+        profile.permutation.cycles += plan.profile.permutation.cycles;
+        profile.permutation.calls  += plan.profile.permutation.calls;
+        plan.profile = {};
+        first += numStages;
+    }
+}
+#endif
+
+// X[k] = U[k] + w^k Z[k] + w^-k Z'[k], with U the transform of the even
+// inputs, Z of x[4m + 1] and Z' of x[4m - 1]. Both quarters share the one
+// twiddle load per k.
+template <typename T, typename Allocator>
+template <typename Source>
+void FFTComplex<T, Allocator>::performSplitRadix (const Source& input, const size_t stride, std::complex<T>* output, const size_t n, const size_t level, bool inverse)
+{
+    if (n <= 8)
+    {
+        FFTPP_PROFILE_SCOPE (profile.stages[level]);
+
+        const auto scale = inverse ? inverseScale : forwardScale;
+
+        switch (n)
+        {
+            case 8:  leaf8 (input, stride, output, scale, inverse); break;
+            case 4:  leaf4 (input, stride, output, scale, inverse); break;
+            default: leaf2 (input, stride, output, scale); break;
+        }
+
+        return;
+    }
+
+    const auto quarter = n / 4;
+
+    performSplitRadix (input, stride * 2, output, n / 2, level + 1, inverse);
+    performSplitRadix (input + stride, stride * 4, output + 2 * quarter, quarter, level + 2, inverse);
+    performSplitRadix (input + (size - stride), stride * 4, output + 3 * quarter, quarter, level + 2, inverse);
+
+    FFTPP_PROFILE_SCOPE (profile.stages[level]);
+
+    butterflySplitRadix (output, quarter, block.template get<std::complex<T>> (splitRadixOffset) + (size - n) / 2, inverse);
+}
+
+template <typename T, typename Allocator>
+template <typename Source>
+void FFTComplex<T, Allocator>::perform (Source input, std::complex<T>* output, const size_t stride, Factor* factors, bool inverse)
+{
+    const auto& factor = *factors++;
+    const auto radix  = factor.radix;
+    const auto length = factor.length;
+
+    if (length == 1)
+    {
+        leaf (factor, input, stride, output, inverse);
+        return;
+    }
+
+    auto* outBegin = output;
+    const auto* outEnd = outBegin + radix * length;
+
+    do
+    {
+        perform (input, output, stride * radix, factors, inverse);
+        input = input + stride;
+    } 
+    while ((output += length) != outEnd);
+
+    butterfly (factor, outBegin, inverse);
+}
+
+template <typename T, typename Allocator>
+template <typename Source>
+void FFTComplex<T, Allocator>::performPermuted (const Source& input, std::complex<T>* output, bool inverse)
+{
+    permute (input, output);
+    performStages (output, factors, inverse);
+}
+
+// One sequential write pass, after which every stage runs in place
+template <typename T, typename Allocator>
+template <typename Source>
+void FFTComplex<T, Allocator>::permute (const Source& input, std::complex<T>* output)
+{
+    FFTPP_PROFILE_SCOPE (profile.permutation);
+
+    const auto* perm = block.template get<uint32_t> (permutationOffset);
+
+    for (size_t j = 0; j < size; ++j)
+        output[j] = input[perm[j]];
+}
+
+template <typename T, typename Allocator>
+template <typename Source>
+void FFTComplex<T, Allocator>::performAllButLast (const Source& input, std::complex<T>* output, bool inverse)
+{
+    assert (hasLastStage());
+
+    FFTPP_PROFILE_SCOPE (profile.transforms);
+
+    const auto& last = factors[0];
+
+    if (usePermutation)
+    {
+        permute (input, output);
+
+        for (size_t q = 0; q < last.radix; ++q)
+            performStages (output + q * last.length, factors + 1, inverse);
+    }
+    else
+    {
+        for (size_t q = 0; q < last.radix; ++q)
+            perform (input + q, output + q * last.length, last.radix, factors + 1, inverse);
+    }
+}
+
+template <typename T, typename Allocator>
+template <size_t Radix>
+inline void FFTComplex<T, Allocator>::butterflyColumn (const std::complex<T>* input, const size_t length, const std::complex<T>* twiddles, std::complex<T>* column, bool inverse)
+{
+    static_assert (Radix == 2 || Radix == 4);
+
+    std::complex<T> x[Radix];
+
+    for (size_t q = 0; q < Radix; ++q)
+    {
+        x[q] = input[q * length];
+
+        if constexpr (fftpp_is_integral<T>)
+            cdiv (x[q], Radix);
+
+        if (q != 0 && twiddles != nullptr)
+            x[q] = cmul (x[q], twiddles[q - 1], inverse);
+    }
+
+    if constexpr (Radix == 2)
+    {
+        column[0] = x[0] + x[1];
+        column[1] = x[0] - x[1];
+    }
+    else
+    {
+        dft4 (x[0], x[1], x[2], x[3], column, 1, inverse);
+    }
+}
+
+template <typename T, typename Allocator>
+void FFTComplex<T, Allocator>::performStages (std::complex<T>* output, Factor* factors, bool inverse)
+{
+    const auto& factor = *factors++;
+
+    if (factor.length == 1)
+    {
+        leaf (factor, FFTSource<T> { reinterpret_cast<const T*> (output), 2, 1 }, 1, output, inverse);
+        return;
+    }
+
+    for (size_t q = 0; q < factor.radix; ++q)
+        performStages (output + q * factor.length, factors, inverse);
+
+    butterfly (factor, output, inverse);
+}
+
+template <typename T, typename Allocator>
+void FFTComplex<T, Allocator>::butterfly (const Factor& factor, std::complex<T>* output, bool inverse)
+{
+    FFTPP_PROFILE_SCOPE (profile.stages[&factor - factors]);
+
+    const auto* tw = block.template get<std::complex<T>> (factor.twiddles);
+
+    switch (factor.radix)
+    {
+        case 2:  butterfly2 (output, factor.length, tw, inverse); break;
+        case 4:  butterfly4 (output, factor.length, tw, inverse); break;
+        case 11: butterflyPrime<11> (output, factor.length, tw, inverse); break;
+        case 13: butterflyPrime<13> (output, factor.length, tw, inverse); break;
+        default: butterflyGeneric (output, factor.radix, factor.length, tw, inverse); break;
+    }
+}
+
+// The leaves run the first pass straight off the strided input: every
+// twiddle there is 1, so they are plain DFTs. They load all inputs before
+// storing, so they also run in place with input == output.
+template <typename T, typename Allocator>
+template <typename Source>
+void FFTComplex<T, Allocator>::leaf (const Factor& factor, const Source& input, const size_t inputStride, std::complex<T>* output, bool inverse)
+{
+    FFTPP_PROFILE_SCOPE (profile.stages[&factor - factors]);
+
+    const auto scale = inverse ? inverseScale : forwardScale;
+
+    switch (factor.radix)
+    {
+        case 2:  leaf2 (input, inputStride, output, scale); break;
+        case 4:  leaf4 (input, inputStride, output, scale, inverse); break;
+        case 8:  leaf8 (input, inputStride, output, scale, inverse); break;
+        case 11: leafPrime<11> (input, inputStride, output, scale, inverse); break;
+        case 13: leafPrime<13> (input, inputStride, output, scale, inverse); break;
+        default: leafGeneric (input, inputStride, output, factor.radix, block.template get<std::complex<T>> (factor.twiddles), scale, inverse); break;
+    }
+}
+
+template <typename T, typename Allocator>
+template <typename Source>
+void FFTComplex<T, Allocator>::leaf2 (const Source& input, const size_t inputStride, std::complex<T>* output, const T scale)
+{
+    auto x0 = leafLoad (input[0], 2, scale);
+    auto x1 = leafLoad (input[inputStride], 2, scale);
+
+    output[0] = x0 + x1;
+    output[1] = x0 - x1;
+}
+
+template <typename T, typename Allocator>
+template <typename Source>
+void FFTComplex<T, Allocator>::leaf4 (const Source& input, const size_t inputStride, std::complex<T>* output, const T scale, bool inverse)
+{
+    dft4 (leafLoad (input[0], 4, scale),
+          leafLoad (input[inputStride], 4, scale),
+          leafLoad (input[inputStride * 2], 4, scale),
+          leafLoad (input[inputStride * 3], 4, scale), output, 1, inverse);
+}
+
+template <typename T, typename Allocator>
+template <typename Source>
+void FFTComplex<T, Allocator>::leaf8 (const Source& input, const size_t inputStride, std::complex<T>* output, const T scale, bool inverse)
+{
+    std::complex<T> x[8], e[4], o[4];
+
+    for (size_t q = 0; q < 8; ++q)
+        x[q] = leafLoad (input[q * inputStride], 8, scale);
+
+    dft4 (x[0], x[2], x[4], x[6], e, 1, inverse);
+    dft4 (x[1], x[3], x[5], x[7], o, 1, inverse);
+
+    o[1] = mulEighth (o[1], inverse);
+    o[2] = rotate (o[2], inverse);
+    o[3] = rotate (mulEighth (o[3], inverse), inverse);
+
+    for (size_t k = 0; k < 4; ++k)
+    {
+        output[k]     = e[k] + o[k];
+        output[k + 4] = e[k] - o[k];
+    }
+}
+
+template <typename T, typename Allocator>
+template <size_t Radix, typename Source>
+void FFTComplex<T, Allocator>::leafPrime (const Source& input, const size_t inputStride, std::complex<T>* output, const T scale, bool inverse)
+{
+    std::complex<T> x[Radix];
+
+    for (size_t q = 0; q < Radix; ++q)
+        x[q] = leafLoad (input[q * inputStride], Radix, scale);
+
+    dftPrime<T, Radix> (x, output, 1, inverse);
+}
+
+template <typename T, typename Allocator>
+template <typename Source>
+void FFTComplex<T, Allocator>::leafGeneric (const Source& input, const size_t inputStride, std::complex<T>* output, const size_t radix, const std::complex<T>* roots, const T scale, bool inverse)
+{
+    auto* scratch = (std::complex<T>*) alloca (sizeof (std::complex<T>) * radix);
+
+    for (size_t q = 0; q < radix; ++q)
+        scratch[q] = leafLoad (input[q * inputStride], radix, scale);
+
+    dft (scratch, output, 1, radix, roots, inverse);
+}
+
+// The first iteration of each butterfly has all twiddles equal to 1 and is
+// peeled off. For even lengths the middle iteration sits on odd multiples
+// of pi/4, where -i is a swap and e^(-i pi/4) needs two multiplies, not four.
+template <typename T, typename Allocator>
+void FFTComplex<T, Allocator>::butterfly2 (std::complex<T>* output, const size_t length, const std::complex<T>* twiddles, bool inverse)
+{
+    auto* output2 = output + length;
+    const auto* middle = length % 2 == 0 ? output + length / 2 : nullptr;
+    const auto* outEnd = output + length;
+
+    auto combine = [&] (std::complex<T> t)
+    {
+        (*output2++) = (*output) - t;
+        (*output++) += t;
+    };
+
+    if constexpr (fftpp_is_integral<T>)
+    {
+        for (auto i = 0; i < length; ++i)
+        {
+            cdiv (output[i],  2);
+            cdiv (output2[i], 2);
+        }
+    }
+
+    combine (*output2);
+    ++twiddles;
+
+    while (output != outEnd)
+    {
+        if (output == middle)
+            combine (rotate (*output2, inverse));
+        else
+            combine (cmul (*output2, *twiddles, inverse));
+
+        ++twiddles;
+    }
+}
+
+template <typename T, typename Allocator>
+void FFTComplex<T, Allocator>::butterfly4 (std::complex<T>* output, const size_t length, const std::complex<T>* twiddles, bool inverse)
+{
+    const auto* outEnd = output + length;
+    const auto* middle = length % 2 == 0 ? output + length / 2 : nullptr;
+    
+    const size_t length2 = 2 * length;
+    const size_t length3 = 3 * length;
+
+    if constexpr (fftpp_is_integral<T>)
+    {
+        do
+        {
+            cdiv (output[length],  4);
+            cdiv (output[length2], 4);
+            cdiv (output[length3], 4);
+            cdiv (*output++, 4);
+        } 
+        while (output != outEnd);
+
+        output = output - length;
+    }
+
+    auto combine = [&] (std::complex<T> s0, std::complex<T> s1, std::complex<T> s2)
+    {
+        auto s3 = s0 + s2;
+        auto s4 = s0 - s2;
+        auto s5 = (*output) - s1;
+
+        (*output) += s1;
+        output[length2] = (*output) - s3;
+        (*output) += s3;
+
+        if (inverse)
+        {
+            output[length]  = { s5.real() - s4.imag(),
+                                s5.imag() + s4.real() };
+            output[length3] = { s5.real() + s4.imag(),
+                                s5.imag() - s4.real() };
+        }
+        else
         {
             output[length]  = { s5.real() + s4.imag(),
                                 s5.imag() - s4.real() };
             output[length3] = { s5.real() - s4.imag(),
                                 s5.imag() + s4.real() };
         }
+    };
 
-        tw1 += stride;
-        tw2 += stride * 2;
-        tw3 += stride * 3;
-    } 
-    while (++output != outEnd);
+    combine (output[length], output[length2], output[length3]);
+    twiddles += 3;
+
+    while (++output != outEnd)
+    {
+        if (output == middle)
+        {
+            combine (mulEighth (output[length], inverse),
+                     rotate (output[length2], inverse),
+                     rotate (mulEighth (output[length3], inverse), inverse));
+        }
+        else
+        {
+            combine (cmul (output[length],  twiddles[0], inverse),
+                     cmul (output[length2], twiddles[1], inverse),
+                     cmul (output[length3], twiddles[2], inverse));
+        }
+
+        twiddles += 3;
+    }
 }
 
-template <typename T>
-void FFTComplex<T>::butterflyGeneric (std::complex<T>* output, const size_t stride, const size_t radix, const size_t length, std::complex<T>* twiddles)
+template <typename T, typename Allocator>
+template <size_t Radix>
+void FFTComplex<T, Allocator>::butterflyPrime (std::complex<T>* output, const size_t length, const std::complex<T>* twiddles, bool inverse)
+{
+    std::complex<T> x[Radix];
+
+    if constexpr (fftpp_is_integral<T>)
+    {
+        for (size_t k = 0; k < Radix * length; ++k)
+            cdiv (output[k], Radix);
+    }
+
+    for (size_t q = 0; q < Radix; ++q)
+        x[q] = output[q * length];
+
+    dftPrime<T, Radix> (x, output, length, inverse);
+    twiddles += Radix - 1;
+
+    for (size_t u = 1; u < length; ++u, twiddles += Radix - 1)
+    {
+        x[0] = output[u];
+
+        for (size_t q = 1; q < Radix; ++q)
+            x[q] = cmul (output[u + q * length], twiddles[q - 1], inverse);
+
+        dftPrime<T, Radix> (x, output + u, length, inverse);
+    }
+}
+
+// U[k] and U[k + n/4] followed by Z[k] and Z'[k], combined in place. For
+// fixed point U comes in scaled by 2/n and Z, Z' by 4/n, hence the
+// halving and quartering.
+template <typename T, typename Allocator>
+void FFTComplex<T, Allocator>::butterflySplitRadix (std::complex<T>* output, const size_t quarter, const std::complex<T>* twiddles, bool inverse)
+{
+    auto* output1 = output + quarter;
+    auto* output2 = output + 2 * quarter;
+    auto* output3 = output + 3 * quarter;
+    const auto middle = quarter / 2;
+
+    if constexpr (fftpp_is_integral<T>)
+    {
+        for (size_t k = 0; k < 2 * quarter; ++k)
+        {
+            cdiv (output[k],  2);
+            cdiv (output2[k], 4);
+        }
+    }
+
+    auto combine = [&] (size_t k, std::complex<T> a, std::complex<T> b)
+    {
+        const auto s  = a + b;
+        const auto d  = rotate (a - b, inverse);
+        const auto u0 = output[k];
+        const auto u1 = output1[k];
+
+        output[k]  = u0 + s;
+        output1[k] = u1 + d;
+        output2[k] = u0 - s;
+        output3[k] = u1 - d;
+    };
+
+    combine (0, output2[0], output3[0]);
+
+    for (size_t k = 1; k < quarter; ++k)
+    {
+        if (k == middle)
+            combine (k, mulEighth (output2[k], inverse), mulEighth (output3[k], ! inverse));
+        else
+            combine (k, cmul (output2[k], twiddles[k], inverse), cmul (output3[k], twiddles[k], ! inverse));
+    }
+}
+
+template <typename T, typename Allocator>
+void FFTComplex<T, Allocator>::butterflyGeneric (std::complex<T>* output, const size_t radix, const size_t length, const std::complex<T>* twiddles, bool inverse)
 {
     auto* scratch = (std::complex<T>*) alloca (sizeof (std::complex<T>) * radix);
+    const auto* roots = twiddles + (radix - 1) * length;
 
     if constexpr (fftpp_is_integral<T>)
     {
@@ -345,27 +1647,14 @@ void FFTComplex<T>::butterflyGeneric (std::complex<T>* output, const size_t stri
 
     for (auto u = 0; u < length; ++u)
     {
-        for (auto k = u, q1 = 0; q1 < radix; ++q1)
-        {
-            scratch[q1] = output[k];
-            k += length;
-        }
+        scratch[0] = output[u];
 
-        for (auto k = u, q1 = 0; q1 < radix; ++q1)
+        for (size_t k = u + length, q = 1; q < radix; ++q)
         {
-            output[k] = scratch[0];
-
-            for (auto twIndex = 0, q = 1; q < radix; ++q)
-            {
-                twIndex += stride * k;
-
-                if (twIndex >= size)
-                    twIndex -= size;
-
-                output[k] += cmul (scratch[q], twiddles[twIndex]);
-            }
-
+            scratch[q] = cmul (output[k], *twiddles++, inverse);
             k += length;
         }
+
+        dft (scratch, output + u, length, radix, roots, inverse);
     }
 }
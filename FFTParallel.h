@@ -0,0 +1,176 @@
+/*
+MIT License
+
+Copyright (c) 2024 Ragnar Hrafnkelsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdio>
+#include <map>
+#include <string>
+#include "FFTAsync.h"
+#include "FFTComplex.h"
+
+// Usable CPUs grouped by the cache of the given level they share, e.g. the
+// SMT siblings of one core for a private L2. Read from Linux sysfs; a group
+// per CPU where the topology is unknown. Pass the result to FFTThreadPool
+// for one pinned worker per cache domain.
+static inline std::vector<std::vector<int>> fftpp_cache_domains (int level = 2)
+{
+    const auto numCpus = (int) std::max (1u, std::thread::hardware_concurrency());
+    std::map<std::string, std::vector<int>> domains;
+
+   #if defined (__linux__)
+    const int maxCpus = CPU_SETSIZE;
+    cpu_set_t allowed;
+    CPU_ZERO (&allowed);
+    const auto haveAffinity = sched_getaffinity (0, sizeof (allowed), &allowed) == 0;
+   #else
+    const int maxCpus = numCpus;
+   #endif
+
+    for (int cpu = 0, found = 0; cpu < maxCpus && found < numCpus; ++cpu)
+    {
+        std::string shared = std::to_string (cpu);
+
+       #if defined (__linux__)
+        if (haveAffinity && ! CPU_ISSET (cpu, &allowed))
+            continue;
+
+        for (int index = 0;; ++index)
+        {
+            char path[128], text[256];
+            std::snprintf (path, sizeof (path), "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu, index);
+
+            auto* file = std::fopen (path, "r");
+
+            if (file == nullptr)
+                break;
+
+            int cacheLevel = 0;
+            const auto matches = std::fscanf (file, "%d", &cacheLevel) == 1 && cacheLevel == level;
+            std::fclose (file);
+
+            if (! matches)
+                continue;
+
+            std::snprintf (path, sizeof (path), "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list", cpu, index);
+
+            if ((file = std::fopen (path, "r")) != nullptr)
+            {
+                if (std::fgets (text, sizeof (text), file) != nullptr)
+                    shared = text;
+
+                std::fclose (file);
+            }
+
+            break;
+        }
+       #endif
+
+        domains[shared].push_back (cpu);
+        ++found;
+    }
+
+    std::vector<std::vector<int>> result;
+
+    for (auto& domain : domains)
+        result.push_back (std::move (domain.second));
+
+    std::sort (result.begin(), result.end());
+    return result;
+}
+
+//==============================================================================
+// Batched transforms spread over a thread pool. Every worker owns a copy of
+// the plan, built on that worker so that its tables are first touched, and
+// stay, in the cache and NUMA node it runs on. Frames are split into one
+// contiguous range per worker, the same range each call, so a worker keeps
+// transforming the same frames with the same warm plan.
+template <typename Plan>
+class FFTBatch
+{
+public:
+    //==========================================================================
+    FFTBatch (FFTThreadPool& poolToUse, size_t fftSize, const FFTOptions& options = {})
+      : pool (poolToUse), plans (pool.getNumThreads())
+    {
+        pending.reserve (plans.size());
+
+        for (size_t w = 0; w < plans.size(); ++w)
+            pending.push_back (pool.submitTo (w, [this, w, fftSize, options] { plans[w] = std::make_unique<Plan> (fftSize, options); }));
+
+        wait();
+    }
+
+    // Frame b is read at input + b * inDistance and written at output +
+    // b * outDistance, in elements of each pointer's type. Blocks until the
+    // whole batch is done.
+    template <typename Input, typename Output>
+    void forward (size_t count, const Input* input, size_t inDistance, Output* output, size_t outDistance)
+    {
+        run (count, [=] (Plan& plan, size_t b) { plan.forward (input + b * inDistance, output + b * outDistance); });
+    }
+
+    template <typename Input, typename Output>
+    void inverse (size_t count, const Input* input, size_t inDistance, Output* output, size_t outDistance)
+    {
+        run (count, [=] (Plan& plan, size_t b) { plan.inverse (input + b * inDistance, output + b * outDistance); });
+    }
+
+    size_t getNumPlans() const noexcept   { return plans.size(); }
+
+private:
+    //==========================================================================
+    template <typename Fn>
+    void run (size_t count, Fn fn)
+    {
+        const auto numWorkers = plans.size();
+
+        for (size_t w = 0; w < numWorkers; ++w)
+        {
+            const auto begin = count * w / numWorkers;
+            const auto end   = count * (w + 1) / numWorkers;
+
+            if (begin != end)
+                pending.push_back (pool.submitTo (w, [this, w, begin, end, fn]
+                {
+                    for (auto b = begin; b < end; ++b)
+                        fn (*plans[w], b);
+                }));
+        }
+
+        wait();
+    }
+
+    void wait()
+    {
+        for (auto& job : pending)
+            job.get();
+
+        pending.clear();
+    }
+
+    FFTThreadPool& pool;
+    std::vector<std::unique_ptr<Plan>> plans;
+    std::vector<std::future<void>> pending;
+};
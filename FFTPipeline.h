@@ -0,0 +1,355 @@
+/*
+MIT License
+
+Copyright (c) 2024 Ragnar Hrafnkelsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+// Coroutine building blocks for streaming chains of transforms, e.g.
+// decode -> frame -> FFT -> features -> encode. Every stage is a coroutine
+// on one FFTScheduler thread, linked by bounded FFTChannels: a stage pushing
+// into a full channel suspends until the next one catches up. Handing a frame
+// on resumes the waiting stage in place of a thread switch, and the queues
+// are intrusive, so steady state streaming doesn't allocate.
+//
+// Needs C++20 coroutines, the rest of the library builds as C++17.
+
+#if defined (__cpp_impl_coroutine)
+
+#include <array>
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include "FFTReal.h"
+
+// Suspended coroutine waiting in a scheduler or channel queue
+struct FFTWaiter
+{
+    std::coroutine_handle<> handle;
+    FFTWaiter* next = nullptr;
+};
+
+// FIFO of waiters linked through FFTWaiter::next
+class FFTWaiterQueue
+{
+public:
+    //==========================================================================
+    bool empty() const noexcept   { return head == nullptr; }
+
+    void push (FFTWaiter& waiter) noexcept
+    {
+        waiter.next = nullptr;
+        (tail != nullptr ? tail->next : head) = &waiter;
+        tail = &waiter;
+    }
+
+    FFTWaiter& pop() noexcept
+    {
+        auto& waiter = *head;
+        head = waiter.next;
+
+        if (head == nullptr)
+            tail = nullptr;
+
+        return waiter;
+    }
+
+private:
+    //==========================================================================
+    FFTWaiter* head = nullptr;
+    FFTWaiter* tail = nullptr;
+};
+
+//==============================================================================
+// Lazily started coroutine. co_await runs it to completion and resumes the
+// awaiter, or hand it to FFTScheduler::start. Exceptions terminate.
+class FFTTask
+{
+public:
+    //==========================================================================
+    struct promise_type
+    {
+        FFTWaiter waiter;
+        std::coroutine_handle<> continuation;
+
+        FFTTask get_return_object() noexcept   { return FFTTask (Handle::from_promise (*this)); }
+        std::suspend_always initial_suspend() noexcept   { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept   { std::terminate(); }
+
+        auto final_suspend() noexcept
+        {
+            struct Resume
+            {
+                bool await_ready() noexcept   { return false; }
+                void await_resume() noexcept {}
+
+                std::coroutine_handle<> await_suspend (std::coroutine_handle<promise_type> h) noexcept
+                {
+                    auto continuation = h.promise().continuation;
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+            };
+
+            return Resume {};
+        }
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    FFTTask (FFTTask&& other) noexcept  : handle (std::exchange (other.handle, {})) {}
+    FFTTask& operator= (FFTTask&& other) noexcept   { std::swap (handle, other.handle); return *this; }
+    ~FFTTask()   { if (handle) handle.destroy(); }
+
+    bool done() const noexcept   { return ! handle || handle.done(); }
+
+    auto operator co_await() noexcept
+    {
+        struct Start
+        {
+            Handle task;
+
+            bool await_ready() noexcept   { return ! task || task.done(); }
+            void await_resume() noexcept {}
+
+            std::coroutine_handle<> await_suspend (std::coroutine_handle<> awaiter) noexcept
+            {
+                task.promise().continuation = awaiter;
+                return task;
+            }
+        };
+
+        return Start { handle };
+    }
+
+private:
+    //==========================================================================
+    friend class FFTScheduler;
+
+    explicit FFTTask (Handle h) noexcept  : handle (h) {}
+
+    Handle handle;
+};
+
+//==============================================================================
+// Runs coroutines one after another on the thread that calls run()
+class FFTScheduler
+{
+public:
+    //==========================================================================
+    // Queues task to start on the next run(). It must outlive the run.
+    void start (FFTTask& task) noexcept
+    {
+        auto& waiter = task.handle.promise().waiter;
+        waiter.handle = task.handle;
+        post (waiter);
+    }
+
+    void post (FFTWaiter& waiter) noexcept   { ready.push (waiter); }
+
+    // Resumes queued coroutines until none are left runnable
+    void run()
+    {
+        while (! ready.empty())
+            ready.pop().handle.resume();
+    }
+
+    // Requeues the awaiting coroutine behind everything already runnable
+    auto yield() noexcept
+    {
+        struct Yield : FFTWaiter
+        {
+            FFTScheduler& scheduler;
+
+            bool await_ready() noexcept   { return false; }
+            void await_resume() noexcept {}
+
+            void await_suspend (std::coroutine_handle<> h) noexcept
+            {
+                handle = h;
+                scheduler.post (*this);
+            }
+        };
+
+        return Yield { {}, *this };
+    }
+
+private:
+    //==========================================================================
+    FFTWaiterQueue ready;
+};
+
+//==============================================================================
+// Bounded queue of frames between two stages on the same scheduler. Frames
+// are moved in and out of a fixed ring, so a frame that owns its buffers
+// passes through without allocating.
+template <typename Frame, size_t Capacity>
+class FFTChannel
+{
+public:
+    //==========================================================================
+    static_assert (Capacity > 0, "Channels need room for at least one frame.");
+
+    explicit FFTChannel (FFTScheduler& schedulerToUse) noexcept
+      : scheduler (schedulerToUse) {}
+
+    struct Push : FFTWaiter
+    {
+        FFTChannel& channel;
+        Frame& frame;
+
+        bool await_ready() noexcept   { return channel.tryPush (frame); }
+        void await_resume() noexcept {}
+
+        void await_suspend (std::coroutine_handle<> h) noexcept
+        {
+            handle = h;
+            channel.pushers.push (*this);
+        }
+    };
+
+    struct Pop : FFTWaiter
+    {
+        FFTChannel& channel;
+        std::optional<Frame> frame;
+
+        bool await_ready() noexcept   { return channel.tryPop (frame); }
+        std::optional<Frame> await_resume() noexcept   { return std::move (frame); }
+
+        void await_suspend (std::coroutine_handle<> h) noexcept
+        {
+            handle = h;
+            channel.poppers.push (*this);
+        }
+    };
+
+    // Suspends while the channel is full
+    Push push (Frame&& frame) noexcept
+    {
+        assert (! closed && "Push to a closed channel.");
+        return { {}, *this, frame };
+    }
+
+    // Suspends while the channel is empty. Yields nullopt once it is closed
+    // and drained.
+    Pop pop() noexcept   { return { {}, *this, std::nullopt }; }
+
+    // No more frames: wakes the waiting consumers once the ring is drained
+    void close() noexcept
+    {
+        closed = true;
+
+        while (! poppers.empty())
+            scheduler.post (poppers.pop());
+    }
+
+private:
+    //==========================================================================
+    // Consumers only wait on an empty ring, so hand the frame straight over
+    bool tryPush (Frame& frame) noexcept
+    {
+        if (! poppers.empty())
+        {
+            auto& popper = static_cast<Pop&> (poppers.pop());
+            popper.frame.emplace (std::move (frame));
+            scheduler.post (popper);
+            return true;
+        }
+
+        if (count == Capacity)
+            return false;
+
+        slots[(first + count++) % Capacity] = std::move (frame);
+        return true;
+    }
+
+    // Producers only wait on a full ring, so refill the slot just freed
+    bool tryPop (std::optional<Frame>& frame) noexcept
+    {
+        if (count == 0)
+            return closed;
+
+        frame.emplace (std::move (slots[first]));
+        first = (first + 1) % Capacity;
+        --count;
+
+        if (! pushers.empty())
+        {
+            auto& pusher = static_cast<Push&> (pushers.pop());
+            slots[(first + count++) % Capacity] = std::move (pusher.frame);
+            scheduler.post (pusher);
+        }
+
+        return true;
+    }
+
+    FFTScheduler& scheduler;
+    std::array<Frame, Capacity> slots;
+    size_t first = 0, count = 0;
+    FFTWaiterQueue pushers, poppers;
+    bool closed = false;
+};
+
+//==============================================================================
+// Frame carried through FFTReal stages, transformed in place of a copy
+template <typename T>
+struct FFTFrame
+{
+    std::vector<T> time;                    // getSize() samples
+    std::vector<std::complex<T>> spectrum;  // getSize() / 2 + 1 bins
+};
+
+// Fills each frame's spectrum from its time samples, windowed by the plan's
+// FFTOptions::window if it has one. Closes output once input is closed.
+template <typename T, typename Allocator, size_t InputCapacity, size_t OutputCapacity>
+FFTTask fftForwardStage (FFTReal<T, Allocator>& plan, FFTChannel<FFTFrame<T>, InputCapacity>& input,
+                         FFTChannel<FFTFrame<T>, OutputCapacity>& output)
+{
+    while (auto frame = co_await input.pop())
+    {
+        if (const auto* window = plan.getWindow())
+            plan.forward (frame->time.data(), window, frame->spectrum.data());
+        else
+            plan.forward (frame->time.data(), frame->spectrum.data());
+
+        co_await output.push (std::move (*frame));
+    }
+
+    output.close();
+}
+
+// Fills each frame's time samples from its spectrum
+template <typename T, typename Allocator, size_t InputCapacity, size_t OutputCapacity>
+FFTTask fftInverseStage (FFTReal<T, Allocator>& plan, FFTChannel<FFTFrame<T>, InputCapacity>& input,
+                         FFTChannel<FFTFrame<T>, OutputCapacity>& output)
+{
+    while (auto frame = co_await input.pop())
+    {
+        plan.inverse (frame->spectrum.data(), frame->time.data());
+        co_await output.push (std::move (*frame));
+    }
+
+    output.close();
+}
+
+#endif
@@ -28,23 +28,133 @@ SOFTWARE.
 #include <cstring>
 #include "FFTComplex.h"
 
+// Sink adding windowed real samples into a ring buffer of ringSize, starting
+// at offset and wrapping to its start. A null window adds them unweighted.
 template <typename T>
+struct FFTOverlapAddSink
+{
+    T* data;
+    size_t ringSize, offset;
+    const T* window;
+
+    std::complex<T>* contiguous() const noexcept   { return nullptr; }
+
+    void write (const std::complex<T>* result, size_t size) const
+    {
+        const auto* samples = reinterpret_cast<const T*> (result);
+        const auto numSamples = 2 * size;
+        const auto head = std::min (numSamples, ringSize - offset);
+
+        auto add = [&] (T* output, size_t begin, size_t end)
+        {
+            if (window != nullptr)
+                for (auto n = begin; n < end; ++n)
+                    output[n] += smul (samples[n], window[n]);
+            else
+                for (auto n = begin; n < end; ++n)
+                    output[n] += samples[n];
+        };
+
+        add (data + offset, 0, head);
+        add (data - head, head, numSamples);
+    }
+};
+
+// Smallest inner size for which FFTReal::forward() fuses its split pass
+// into the last stage. Below it the spectrum is in cache anyway and the
+// separate passes are cheaper than running the sub-transforms one by one.
+constexpr size_t fftpp_fused_split_threshold = 512;
+
+template <typename T, typename Allocator = FFTAlignedAllocator<std::complex<T>>>
 class FFTReal
 {
 public:
     //==========================================================================
-    FFTReal (size_t size);
-    
-    void forward (const T* timeData, std::complex<T>* freqData);
-    void inverse (const std::complex<T>* freqData, T* timeData);
+    FFTReal (size_t size, const FFTOptions& options = {}, const Allocator& allocator = Allocator());
+
+    // Copies get their own tables, moves take them over
+    FFTReal (const FFTReal&);
+    FFTReal (FFTReal&&) = default;
     
+    // Time strides count real samples and frequency strides complex bins,
+    // so channel c of an interleaved buffer holding n channels is transformed
+    // with data + c and a stride of n. The strided input is read straight
+    // into the first pass. A time output stride other than 1 on inverse
+    // is written from the plan's workspace, which needs
+    // FFTOptions::stridedOutput; without it inverse throws
+    // std::invalid_argument.
+    void forward (const T* timeData, std::complex<T>* freqData, size_t inStride = 1, size_t outStride = 1);
+    void inverse (const std::complex<T>* freqData, T* timeData, size_t inStride = 1, size_t outStride = 1);
+
+    // Inverse that packs the spectrum inside freqData rather than copying it
+    // to tempBuffer, leaving freqData overwritten. timeData must not overlap
+    // it.
+    void inverseInPlace (std::complex<T>* freqData, T* timeData, size_t outStride = 1);
+
+    // Overlap-add synthesis: the inverse transform, multiplied by window if
+    // not null, is added into ringBuffer from offset on, wrapping at
+    // ringSize >= getSize(). The accumulation is the one pass after the last
+    // stage, reading the result from the plan's workspace, so this too needs
+    // FFTOptions::stridedOutput and throws std::invalid_argument without it.
+    void inverseAccumulate (const std::complex<T>* freqData, T* ringBuffer, size_t ringSize, size_t offset,
+                            const T* window = nullptr, size_t inStride = 1);
+
+    // Forward transform of timeData multiplied by window, getSize() samples
+    // indexed by time rather than by stride. The product is formed as the
+    // first pass loads its inputs, with no windowed copy.
+    void forward (const T* timeData, const T* window, std::complex<T>* freqData, size_t inStride = 1, size_t outStride = 1);
+
+    // The table selected by FFTOptions::window, or nullptr. Periodic, so
+    // frames overlapped by the window's hop sum to a constant.
+    const T* getWindow() const noexcept  { return workspaceOffset != windowOffset ? block.template get<T> (windowOffset) : nullptr; }
+
     size_t getSize() const noexcept      { return size * 2; }
 
+    // Stats of the inner complex plan plus the real split pass and buffers
+    FFTPlanStats getStats() const;
+    std::string describe() const         { return getStats().toString(); }
+
+#if FFTPP_INSTRUMENTATION
+    // Inner plan profile, with the split passes counted under realSplit,
+    // along with the last stage of the inner plan when the forward one is
+    // fused into it
+    const FFTProfile& getProfile() const noexcept    { return fft.getProfile(); }
+    void resetProfile() noexcept                     { fft.resetProfile(); }
+#endif
+
 protected:
     //==========================================================================
     const size_t size;
-    FFTComplex<T> fft;
-    std::vector<std::complex<T>> twiddlesFwd, twiddlesInv, tempBuffer;
+
+    // One allocation for the whole plan: the inner plan's tables come first,
+    // then the forward twiddles for k = 1..size/2, which the inverse
+    // conjugates on the fly, tempBuffer, the window if any, and with
+    // FFTOptions::stridedOutput the workspace taking the inverse result for
+    // strided and overlap-add output. All are addressed by offset.
+    FFTBlock<Allocator> block;
+    FFTComplex<T, Allocator> fft;
+    size_t twiddlesOffset, tempBufferOffset, windowOffset, workspaceOffset;
+
+    // FFTOptions::normalization for the real size, fused into the forward
+    // split pass. The inner plan applies the inverse scale.
+    T forwardScale;
+
+    bool fusesSplit() const noexcept    { return size >= fftpp_fused_split_threshold && fft.hasLastStage(); }
+    template <typename Source>
+    void performForward (const Source& input, std::complex<T>* freqData, size_t outStride);
+    void splitForward (std::complex<T>* freqData, size_t outStride);
+    template <size_t Radix>
+    void splitForwardLastStage (std::complex<T>* freqData, size_t outStride);
+    void untangleEdges (std::complex<T> x0, std::complex<T>* freqData, size_t outStride);
+    void untangle (size_t k, std::complex<T> x0, std::complex<T> x1, const std::complex<T>* twiddles, std::complex<T>* freqData, size_t outStride);
+    void splitInverse (const std::complex<T>* freqData, size_t inStride, std::complex<T>* packed);
+    template <typename Sink>
+    void transformInverse (const std::complex<T>* packed, const Sink& output);
+
+    std::complex<T>* getTwiddles() noexcept     { return block.template get<std::complex<T>> (twiddlesOffset); }
+    size_t getTwiddlesBytes() const noexcept    { return tempBufferOffset - twiddlesOffset; }
+    std::complex<T>* getTempBuffer() noexcept   { return block.template get<std::complex<T>> (tempBufferOffset); }
+    std::complex<T>* getWorkspace() noexcept    { return block.template get<std::complex<T>> (workspaceOffset); }
 };
 
 
@@ -52,82 +162,382 @@ protected:
 //
 //==============================================================================
 template <typename T>
-static void initTwiddleTable (std::vector<std::complex<T>>& twiddles, const size_t size, const int inverse)
+static void initTwiddleTable (std::complex<T>* twiddles, const size_t size)
 {
-    twiddles.resize (size);
-
-    for (auto i = 0; i < size; ++i)
+    for (auto i = 0; i < size / 2; ++i)
     {
         const double phase = -3.14159265358979323846264338327 * ((double) (i + 1) / size + 0.5);
-        cexp (twiddles.data() + i, phase * inverse);
+        cexp (twiddles + i, phase);
     }
 }
 
-template <typename T>
-FFTReal<T>::FFTReal (size_t fftSize)
-  : size (halve (fftSize)), fft (size)
+// Sample n of a periodic window of the given size
+static double windowValue (const FFTOptions& options, size_t n, size_t size)
+{
+    const double pi = 3.141592653589793238462643383279502884197169399375105820974944;
+    const double phase = 2 * pi * (double) n / (double) size;
+
+    // Zeroth order modified Bessel function of the first kind
+    auto besselI0 = [] (double x)
+    {
+        double sum = 1, term = 1;
+
+        for (int k = 1; term > 1e-12 * sum; ++k)
+        {
+            term *= (x * x) / (4.0 * k * k);
+            sum += term;
+        }
+
+        return sum;
+    };
+
+    switch (options.window)
+    {
+        case FFTOptions::Window::hann:           return 0.5 - 0.5 * std::cos (phase);
+        case FFTOptions::Window::hamming:        return 0.54 - 0.46 * std::cos (phase);
+        case FFTOptions::Window::blackmanHarris: return 0.35875 - 0.48829 * std::cos (phase) + 0.14128 * std::cos (2 * phase) - 0.01168 * std::cos (3 * phase);
+        case FFTOptions::Window::kaiser:
+        {
+            const auto r = 2.0 * (double) n / (double) size - 1;
+            return besselI0 (options.kaiserBeta * std::sqrt (1 - r * r)) / besselI0 (options.kaiserBeta);
+        }
+        default: return 1;
+    }
+}
+
+// The inner plan is half the size, so pass it the inverse scale of the full
+// real transform as a custom one. It always writes contiguous output, the
+// workspace for strided output being FFTReal's own.
+static FFTOptions innerOptions (FFTOptions options, size_t realSize)
+{
+    options.customScale   = options.getScale (realSize, true);
+    options.normalization = FFTOptions::Normalization::custom;
+    options.stridedOutput = false;
+    return options;
+}
+
+template <typename T, typename Allocator>
+FFTReal<T, Allocator>::FFTReal (size_t fftSize, const FFTOptions& options, const Allocator& allocator)
+  : size (halve (fftSize)), block (allocator), fft (size, innerOptions (options, fftSize), block),
+    forwardScale (fftpp_is_floating_point<T> ? (T) options.getScale (fftSize, false) : 1)
 {
     assert ((size & 1) == 0 && "Real FFT size must be even.");
 
-    initTwiddleTable (twiddlesFwd, size,  1);
-    initTwiddleTable (twiddlesInv, size, -1);
-    tempBuffer.resize (size);
+    twiddlesOffset   = block.template reserve<std::complex<T>> (size / 2);
+    tempBufferOffset = block.template reserve<std::complex<T>> (size);
+    windowOffset     = block.template reserve<T> (options.window != FFTOptions::Window::none ? fftSize : 0);
+    workspaceOffset  = block.template reserve<std::complex<T>> (options.stridedOutput ? size : 0);
+    block.allocate();
+
+    fft.attach (block);
+    fft.fillTables();
+
+    initTwiddleTable (getTwiddles(), size);
+
+    if (options.window != FFTOptions::Window::none)
+    {
+        auto* window = block.template get<T> (windowOffset);
+
+        for (size_t n = 0; n < fftSize; ++n)
+        {
+            const auto w = windowValue (options, n, fftSize);
+
+            if constexpr (fftpp_is_floating_point<T>)
+                window[n] = (T) w;
+            else
+                window[n] = (T) std::floor (0.5 + std::numeric_limits<T>::max() * w);
+        }
+    }
 }
 
-template <typename T>
-void FFTReal<T>::forward (const T* timeData, std::complex<T>* freqData)
+template <typename T, typename Allocator>
+FFTReal<T, Allocator>::FFTReal (const FFTReal& other)
+  : size (other.size), block (other.block), fft (other.fft),
+    twiddlesOffset (other.twiddlesOffset), tempBufferOffset (other.tempBufferOffset),
+    windowOffset (other.windowOffset), workspaceOffset (other.workspaceOffset), forwardScale (other.forwardScale)
+{
+    fft.attach (block);
+}
+
+template <typename T, typename Allocator>
+FFTPlanStats FFTReal<T, Allocator>::getStats() const
+{
+    auto stats = fft.getStats();
+    stats.size = getSize();
+
+    // Split pass over k = 1..size/2: two complex adds, a complex multiply
+    // and four more adds/halvings per bin. It moves only its twiddles when
+    // fused into the last stage, otherwise it rereads tempBuffer.
+    FFTStageInfo split { 2, size / 2, 1, "real-split", getTwiddlesBytes(), (double) (size / 2) * (2 * 2 + 6 + 4 * 2) };
+
+    const auto complexBytes = (double) (size * sizeof (std::complex<T>));
+    stats.flops += split.flops;
+    stats.bytesMoved += (fusesSplit() ? 0 : 2 * complexBytes) + (double) split.twiddleBytes;
+    stats.stages.push_back (split);
+
+    stats.buffers.front().name = "fft.twiddles";
+    stats.buffers.push_back ({ "twiddles", getTwiddlesBytes() });
+    stats.buffers.push_back ({ "tempBuffer", windowOffset - tempBufferOffset });
+
+    if (getWindow() != nullptr)
+        stats.buffers.push_back ({ "window", workspaceOffset - windowOffset });
+
+    if (workspaceOffset != block.getNumBytes())
+        stats.buffers.push_back ({ "workspace", block.getNumBytes() - workspaceOffset });
+
+    stats.bytesAllocated = block.getNumBytes();
+
+    return stats;
+}
+
+template <typename T, typename Allocator>
+void FFTReal<T, Allocator>::forward (const T* timeData, std::complex<T>* freqData, size_t inStride, size_t outStride)
+{
+    // Even samples go to the real parts, odd ones to the imaginary parts
+    performForward (FFTSource<T> { timeData, 2 * inStride, inStride }, freqData, outStride);
+}
+
+template <typename T, typename Allocator>
+void FFTReal<T, Allocator>::forward (const T* timeData, const T* window, std::complex<T>* freqData, size_t inStride, size_t outStride)
+{
+    performForward (FFTWindowedSource<T> { timeData, 2 * inStride, inStride, window }, freqData, outStride);
+}
+
+template <typename T, typename Allocator>
+template <typename Source>
+void FFTReal<T, Allocator>::performForward (const Source& input, std::complex<T>* freqData, size_t outStride)
+{
+    if (! fusesSplit())
+    {
+        fft.transform (input, FFTSink<T> { reinterpret_cast<T*> (getTempBuffer()), 2, 1 }, false);
+        splitForward (freqData, outStride);
+        return;
+    }
+
+    fft.performAllButLast (input, getTempBuffer(), false);
+
+    if (fft.factors[0].radix == 2)
+        splitForwardLastStage<2> (freqData, outStride);
+    else
+        splitForwardLastStage<4> (freqData, outStride);
+}
+
+// Untangles the spectrum of the even/odd packed transform in tempBuffer
+template <typename T, typename Allocator>
+void FFTReal<T, Allocator>::splitForward (std::complex<T>* freqData, size_t outStride)
+{
+    const auto* twiddles   = getTwiddles();
+    const auto* tempBuffer = getTempBuffer();
+
+    FFTPP_PROFILE_SCOPE (fft.profile.realSplit);
+
+    untangleEdges (tempBuffer[0], freqData, outStride);
+
+    for (size_t k = 1; k <= size / 2; ++k)
+        untangle (k, tempBuffer[k], tempBuffer[size - k], twiddles, freqData, outStride);
+}
+
+// Runs the last stage of the inner plan a butterfly iteration at a time.
+// Iteration u yields bins u + q * length, and iteration length - u those
+// of size - u - q * length, so both are untangled into freqData straight
+// from registers and the stage never writes tempBuffer. Iterations 0 and
+// length / 2 hold their own mirrors.
+template <typename T, typename Allocator>
+template <size_t Radix>
+void FFTReal<T, Allocator>::splitForwardLastStage (std::complex<T>* freqData, size_t outStride)
+{
+    const auto* twiddles   = getTwiddles();
+    const auto* tempBuffer = getTempBuffer();
+    const auto& last          = fft.factors[0];
+    const auto length         = last.length;
+    const auto* stageTwiddles = fft.block.template get<std::complex<T>> (last.twiddles);
+
+    FFTPP_PROFILE_SCOPE (fft.profile.realSplit);
+
+    std::complex<T> x[Radix], y[Radix];
+
+    FFTComplex<T, Allocator>::template butterflyColumn<Radix> (tempBuffer, length, nullptr, x, false);
+    untangleEdges (x[0], freqData, outStride);
+
+    if constexpr (Radix == 2)
+    {
+        untangle (length, x[1], x[1], twiddles, freqData, outStride);
+    }
+    else
+    {
+        untangle (length, x[1], x[3], twiddles, freqData, outStride);
+        untangle (2 * length, x[2], x[2], twiddles, freqData, outStride);
+    }
+
+    size_t u = 1;
+
+    for (; 2 * u < length; ++u)
+    {
+        const auto v = length - u;
+
+        FFTComplex<T, Allocator>::template butterflyColumn<Radix> (tempBuffer + u, length, stageTwiddles + u * (Radix - 1), x, false);
+        FFTComplex<T, Allocator>::template butterflyColumn<Radix> (tempBuffer + v, length, stageTwiddles + v * (Radix - 1), y, false);
+
+        if constexpr (Radix == 2)
+        {
+            untangle (u, x[0], y[1], twiddles, freqData, outStride);
+            untangle (v, y[0], x[1], twiddles, freqData, outStride);
+        }
+        else
+        {
+            untangle (u,          x[0], y[3], twiddles, freqData, outStride);
+            untangle (u + length, x[1], y[2], twiddles, freqData, outStride);
+            untangle (v,          y[0], x[3], twiddles, freqData, outStride);
+            untangle (v + length, y[1], x[2], twiddles, freqData, outStride);
+        }
+    }
+
+    if (2 * u == length)
+    {
+        FFTComplex<T, Allocator>::template butterflyColumn<Radix> (tempBuffer + u, length, stageTwiddles + u * (Radix - 1), x, false);
+
+        if constexpr (Radix == 2)
+        {
+            untangle (u, x[0], x[1], twiddles, freqData, outStride);
+        }
+        else
+        {
+            untangle (u,          x[0], x[3], twiddles, freqData, outStride);
+            untangle (u + length, x[1], x[2], twiddles, freqData, outStride);
+        }
+    }
+}
+
+// DC and Nyquist bins from bin 0 of the packed transform
+template <typename T, typename Allocator>
+inline void FFTReal<T, Allocator>::untangleEdges (std::complex<T> x0, std::complex<T>* freqData, size_t outStride)
 {
-    fft.forward (timeData, tempBuffer.data());
+    if constexpr (fftpp_is_integral<T>)
+        cdiv (x0, 2);
+
+    freqData[0]                = { (x0.real() + x0.imag()) * forwardScale, 0 };
+    freqData[size * outStride] = { (x0.real() - x0.imag()) * forwardScale, 0 };
+}
 
+// Bins k and size - k of the real spectrum from x0 and x1, bins k and
+// size - k of the packed transform, for k = 1..size/2
+template <typename T, typename Allocator>
+inline void FFTReal<T, Allocator>::untangle (size_t k, std::complex<T> x0, std::complex<T> x1, const std::complex<T>* twiddles,
+                                             std::complex<T>* freqData, size_t outStride)
+{
     if constexpr (fftpp_is_integral<T>)
     {
-        for (auto k = 0; k < size; ++k)
-            cdiv (tempBuffer[k], 2);
+        cdiv (x0, 2);
+        cdiv (x1, 2);
     }
 
-    auto tdc = tempBuffer[0];
-    freqData[0]    = { tdc.real() + tdc.imag(), 0 };
-    freqData[size] = { tdc.real() - tdc.imag(), 0 };
+    // Floating point folds the normalization into the halving
+    const auto gain = forwardScale * T (0.5);
 
-    for (auto k = 1; k <= size / 2; ++k)
+    auto post = [gain] (T x)
     {
-        auto s0 = tempBuffer[k];
-        auto s1 = std::conj (tempBuffer[size - k]);
-        auto fk   = s0 + s1;
-        auto fknc = s0 - s1;
-        auto tw = cmul (fknc, twiddlesFwd[k - 1]);
+        if constexpr (fftpp_is_integral<T>)
+            return halve (x);
+        else
+            return x * gain;
+    };
+
+    const auto s1   = std::conj (x1);
+    const auto fk   = x0 + s1;
+    const auto fknc = x0 - s1;
+    const auto tw   = cmul (fknc, twiddles[k - 1]);
+
+    freqData[k * outStride]          = { post (fk.real() + tw.real()),
+                                         post (fk.imag() + tw.imag()) };
+    freqData[(size - k) * outStride] = { post (fk.real() - tw.real()),
+                                         post (tw.imag() - fk.imag()) };
+}
 
-        freqData[k]        = { halve (fk.real() + tw.real()),
-                               halve (fk.imag() + tw.imag()) };
-        freqData[size - k] = { halve (fk.real() - tw.real()),
-                               halve (tw.imag() - fk.imag()) };
+template <typename T, typename Allocator>
+void FFTReal<T, Allocator>::inverse (const std::complex<T>* freqData, T* timeData, size_t inStride, size_t outStride)
+{
+    splitInverse (freqData, inStride, getTempBuffer());
+
+    // Real parts land on the even samples, imaginary parts on the odd ones
+    transformInverse (getTempBuffer(), FFTSink<T> { timeData, 2 * outStride, outStride });
+}
+
+template <typename T, typename Allocator>
+void FFTReal<T, Allocator>::inverseInPlace (std::complex<T>* freqData, T* timeData, size_t outStride)
+{
+    splitInverse (freqData, 1, freqData);
+    transformInverse (freqData, FFTSink<T> { timeData, 2 * outStride, outStride });
+}
+
+template <typename T, typename Allocator>
+void FFTReal<T, Allocator>::inverseAccumulate (const std::complex<T>* freqData, T* ringBuffer, size_t ringSize, size_t offset,
+                                               const T* window, size_t inStride)
+{
+    assert (ringSize >= getSize() && offset < ringSize);
+
+    splitInverse (freqData, inStride, getTempBuffer());
+    transformInverse (getTempBuffer(), FFTOverlapAddSink<T> { ringBuffer, ringSize, offset, window });
+}
+
+// Runs the inner plan on the packed spectrum, straight into output when it
+// is contiguous, otherwise into the workspace and from there into output
+template <typename T, typename Allocator>
+template <typename Sink>
+void FFTReal<T, Allocator>::transformInverse (const std::complex<T>* packed, const Sink& output)
+{
+    auto* result = output.contiguous();
+
+    if (result == nullptr)
+    {
+        if (workspaceOffset == block.getNumBytes())
+            throw std::invalid_argument ("Strided and overlap-add output need FFTOptions::stridedOutput.");
+
+        result = getWorkspace();
     }
+
+    fft.transform (FFTSource<T> { reinterpret_cast<const T*> (packed), 2, 1 }, FFTSink<T> { reinterpret_cast<T*> (result), 2, 1 }, true);
+
+    if (result != output.contiguous())
+        output.write (result, size);
 }
 
-template <typename T>
-void FFTReal<T>::inverse (const std::complex<T>* freqData, T* timeData)
+// Packs the Hermitian spectrum into size bins of packed as that of the
+// even/odd complex sequence. Each step reads bins k and size - k before
+// writing them, so packed may be freqData itself.
+template <typename T, typename Allocator>
+void FFTReal<T, Allocator>::splitInverse (const std::complex<T>* freqData, size_t inStride, std::complex<T>* packed)
 {
-	tempBuffer[0] = { freqData[0].real() + freqData[size].real(),
-					  freqData[0].real() - freqData[size].real() };
-    std::memcpy (tempBuffer.data() + 1, freqData + 1, (size - 1) * sizeof (std::complex<T>));
+    auto* twiddles = getTwiddles();
+
+    FFTPP_PROFILE_SCOPE (fft.profile.realSplit);
+
+    packed[0] = { freqData[0].real() + freqData[size * inStride].real(),
+                  freqData[0].real() - freqData[size * inStride].real() };
+
+    if (packed != freqData)
+    {
+        if (inStride == 1)
+            std::memcpy (packed + 1, freqData + 1, (size - 1) * sizeof (std::complex<T>));
+        else
+            for (size_t k = 1; k < size; ++k)
+                packed[k] = freqData[k * inStride];
+    }
 
     if constexpr (fftpp_is_integral<T>)
     {
         for (auto k = 0; k < size; k++)
-            cdiv (tempBuffer[k], 2);
+            cdiv (packed[k], 2);
     }
 
     for (auto k = 1; k <= size / 2; k++)
     {
-        auto s0 = tempBuffer[k];
-        auto s1 = std::conj (tempBuffer[size - k]);
+        auto s0 = packed[k];
+        auto s1 = std::conj (packed[size - k]);
         auto fk   = s0 + s1;
         auto fknc = s0 - s1;
-        auto tw = cmul (fknc, twiddlesInv[k - 1]);
+        auto tw = cmulConj (fknc, twiddles[k - 1]);
 
-        tempBuffer[k]        = fk + tw;
-        tempBuffer[size - k] = std::conj (fk - tw);
+        packed[k]        = fk + tw;
+        packed[size - k] = std::conj (fk - tw);
     }
-
-    fft.inverse (tempBuffer.data(), timeData);
 }
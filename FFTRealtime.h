@@ -0,0 +1,280 @@
+/*
+MIT License
+
+Copyright (c) 2024 Ragnar Hrafnkelsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "FFTReal.h"
+
+// Lock-free ring of preallocated slots for exactly one producer thread and
+// one consumer thread. Slots are filled and read in place: acquire a slot,
+// use it, then publish or release it. No call blocks or allocates.
+template <typename Slot>
+class FFTSpscRing
+{
+public:
+    //==========================================================================
+    template <typename... SlotArgs>
+    FFTSpscRing (size_t numSlots, const SlotArgs&... slotArgs)
+      : slots (numSlots, Slot (slotArgs...)) {}
+
+    size_t getNumSlots() const noexcept   { return slots.size(); }
+
+    // Producer side: the next free slot, or nullptr while the ring is full
+    Slot* acquireWrite() noexcept
+    {
+        const auto write = writeIndex.load (std::memory_order_relaxed);
+
+        if (write - cachedRead == slots.size())
+        {
+            cachedRead = readIndex.load (std::memory_order_acquire);
+
+            if (write - cachedRead == slots.size())
+                return nullptr;
+        }
+
+        return &slots[write % slots.size()];
+    }
+
+    void publishWrite() noexcept
+    {
+        writeIndex.store (writeIndex.load (std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer side: the oldest published slot, or nullptr while empty
+    Slot* acquireRead() noexcept
+    {
+        const auto read = readIndex.load (std::memory_order_relaxed);
+
+        if (read == cachedWrite)
+        {
+            cachedWrite = writeIndex.load (std::memory_order_acquire);
+
+            if (read == cachedWrite)
+                return nullptr;
+        }
+
+        return &slots[read % slots.size()];
+    }
+
+    void releaseRead() noexcept
+    {
+        readIndex.store (readIndex.load (std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    //==========================================================================
+    // Each side's index and its cached copy of the other's share a cache line
+    static constexpr size_t cacheLine = 64;
+
+    std::vector<Slot> slots;
+    alignas (cacheLine) std::atomic<size_t> writeIndex { 0 };
+    size_t cachedRead = 0;
+    alignas (cacheLine) std::atomic<size_t> readIndex { 0 };
+    size_t cachedWrite = 0;
+};
+
+// Time from a frame being submitted to its spectrum being published
+struct FFTLatencyStats
+{
+    uint64_t frames = 0;        // spectra published
+    uint64_t dropped = 0;       // frames refused because the input ring was full
+    double minMs = 0, maxMs = 0, meanMs = 0;
+};
+
+//==============================================================================
+// Runs FFTReal::forward on a dedicated thread. A real-time thread submits
+// frames through one SPSC ring, the worker transforms each one straight into
+// a slot of a second ring, and a consumer reads the spectra from there. The
+// producer side never blocks: with the input ring full, frames are dropped
+// and counted. The worker waits for room rather than dropping spectra.
+template <typename T, typename Allocator = FFTAlignedAllocator<std::complex<T>>>
+class FFTRealtimeWorker
+{
+public:
+    //==========================================================================
+    using Clock = std::chrono::steady_clock;
+
+    struct Frame
+    {
+        explicit Frame (size_t size) : samples (size) {}
+
+        std::vector<T> samples;
+        Clock::time_point submitted;
+    };
+
+    struct Spectrum
+    {
+        explicit Spectrum (size_t size) : bins (size / 2 + 1) {}
+
+        std::vector<std::complex<T>> bins;
+        Clock::time_point submitted;
+        uint64_t sequence = 0;
+    };
+
+    // numSlots frames of fftSize samples each way. The plan's window, if
+    // any, is applied to every frame.
+    FFTRealtimeWorker (size_t fftSize, size_t numSlots, const FFTOptions& options = {}, const Allocator& allocator = Allocator())
+      : fft (fftSize, options, allocator), frames (numSlots, fftSize), spectra (numSlots, fftSize),
+        thread ([this] { run(); })
+    {
+    }
+
+    ~FFTRealtimeWorker()
+    {
+        running.store (false, std::memory_order_relaxed);
+        thread.join();
+    }
+
+    size_t getSize() const noexcept   { return fft.getSize(); }
+
+    //==========================================================================
+    // Producer: a slot of getSize() samples to fill, then submitFrame().
+    // nullptr, counted as dropped, while the worker is behind.
+    T* beginFrame() noexcept
+    {
+        if (auto* frame = frames.acquireWrite())
+            return frame->samples.data();
+
+        dropped.fetch_add (1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    void submitFrame() noexcept
+    {
+        frames.acquireWrite()->submitted = Clock::now();
+        frames.publishWrite();
+    }
+
+    // Copies getSize() samples read at stride into a frame and submits it
+    bool pushFrame (const T* samples, size_t stride = 1) noexcept
+    {
+        auto* frame = beginFrame();
+
+        if (frame == nullptr)
+            return false;
+
+        for (size_t n = 0; n < getSize(); ++n)
+            frame[n] = samples[n * stride];
+
+        submitFrame();
+        return true;
+    }
+
+    //==========================================================================
+    // Consumer: the oldest unread spectrum, or nullptr, then releaseSpectrum()
+    const Spectrum* beginSpectrum() noexcept   { return spectra.acquireRead(); }
+    void releaseSpectrum() noexcept            { spectra.releaseRead(); }
+
+    FFTLatencyStats getLatencyStats() const noexcept
+    {
+        FFTLatencyStats stats;
+        stats.frames  = published.load (std::memory_order_relaxed);
+        stats.dropped = dropped.load (std::memory_order_relaxed);
+
+        if (stats.frames > 0)
+        {
+            stats.minMs  = (double) minNanos.load (std::memory_order_relaxed) * 1e-6;
+            stats.maxMs  = (double) maxNanos.load (std::memory_order_relaxed) * 1e-6;
+            stats.meanMs = (double) totalNanos.load (std::memory_order_relaxed) * 1e-6 / (double) stats.frames;
+        }
+
+        return stats;
+    }
+
+private:
+    //==========================================================================
+    void run()
+    {
+        size_t idleRounds = 0;
+
+        while (running.load (std::memory_order_relaxed))
+        {
+            auto* frame    = frames.acquireRead();
+            auto* spectrum = frame != nullptr ? spectra.acquireWrite() : nullptr;
+
+            if (spectrum == nullptr)
+            {
+                idle (idleRounds++);
+                continue;
+            }
+
+            idleRounds = 0;
+
+            if (const auto* window = fft.getWindow())
+                fft.forward (frame->samples.data(), window, spectrum->bins.data());
+            else
+                fft.forward (frame->samples.data(), spectrum->bins.data());
+
+            spectrum->submitted = frame->submitted;
+            spectrum->sequence  = sequence++;
+            frames.releaseRead();
+            spectra.publishWrite();
+
+            record (Clock::now() - spectrum->submitted);
+        }
+    }
+
+    // Spin briefly for low latency, then back off to yields and short sleeps
+    static void idle (size_t round)
+    {
+        if (round < 64)
+            return;
+
+        if (round < 128)
+            std::this_thread::yield();
+        else
+            std::this_thread::sleep_for (std::chrono::microseconds (50));
+    }
+
+    void record (Clock::duration latency) noexcept
+    {
+        const auto nanos = (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds> (latency).count();
+        const auto count = published.load (std::memory_order_relaxed);
+
+        // Only the worker writes these, readers may see a mix of two updates
+        if (count == 0 || nanos < minNanos.load (std::memory_order_relaxed))
+            minNanos.store (nanos, std::memory_order_relaxed);
+
+        if (nanos > maxNanos.load (std::memory_order_relaxed))
+            maxNanos.store (nanos, std::memory_order_relaxed);
+
+        totalNanos.store (totalNanos.load (std::memory_order_relaxed) + nanos, std::memory_order_relaxed);
+        published.store (count + 1, std::memory_order_relaxed);
+    }
+
+    FFTReal<T, Allocator> fft;
+    FFTSpscRing<Frame> frames;
+    FFTSpscRing<Spectrum> spectra;
+    uint64_t sequence = 0;
+
+    std::atomic<uint64_t> published { 0 }, dropped { 0 };
+    std::atomic<uint64_t> minNanos { 0 }, maxNanos { 0 }, totalNanos { 0 };
+    std::atomic<bool> running { true };
+
+    std::thread thread;
+};
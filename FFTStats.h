@@ -0,0 +1,153 @@
+/*
+MIT License
+
+Copyright (c) 2024 Ragnar Hrafnkelsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Set FFTPP_INSTRUMENTATION to 1 to have plans accumulate cycles and call
+// counts per stage, read back through getProfile(). Off by default, in which
+// case the hooks compile to nothing.
+#ifndef FFTPP_INSTRUMENTATION
+ #define FFTPP_INSTRUMENTATION 0
+#endif
+
+#if FFTPP_INSTRUMENTATION
+ #include <chrono>
+ #include <cstdint>
+ #if defined (_MSC_VER)
+  #include <intrin.h>
+ #elif defined (__x86_64__) || defined (__i386__)
+  #include <x86intrin.h>
+ #endif
+#endif
+
+// One butterfly pass of a plan, outermost (stride 1) first
+struct FFTStageInfo
+{
+    size_t radix, length, stride;
+    const char* kernel;
+    size_t twiddleBytes;
+    double flops;
+};
+
+// What a plan decided and what it costs, see FFTComplex::getStats()
+struct FFTPlanStats
+{
+    struct Buffer { const char* name; size_t bytes; };
+
+    size_t size = 0;
+    std::vector<FFTStageInfo> stages;
+    std::vector<Buffer> buffers;
+
+    size_t bytesAllocated = 0;  // sum of all buffers
+    size_t largestRadix = 0;
+    size_t largestGenericRadix = 0;  // radices above 5 here run the O(radix^2) generic butterfly
+    double flops = 0;           // estimated real adds + multiplies per transform
+    double bytesMoved = 0;      // estimated memory traffic per transform
+
+    bool hasSlowRadix() const noexcept   { return largestGenericRadix > 5; }
+
+    std::string toString() const
+    {
+        char line[256];
+        std::string text;
+
+        std::snprintf (line, sizeof (line), "size %zu, %zu bytes, %.0f flops, %.0f bytes moved\n",
+                       size, bytesAllocated, flops, bytesMoved);
+        text += line;
+
+        for (const auto& stage : stages)
+        {
+            std::snprintf (line, sizeof (line), "  %-12s radix %zu x %zu, stride %zu, %zu twiddle bytes, %.0f flops\n",
+                           stage.kernel, stage.radix, stage.length, stage.stride, stage.twiddleBytes, stage.flops);
+            text += line;
+        }
+
+        for (const auto& buffer : buffers)
+        {
+            std::snprintf (line, sizeof (line), "  buffer %-14s %zu bytes\n", buffer.name, buffer.bytes);
+            text += line;
+        }
+
+        if (hasSlowRadix())
+        {
+            std::snprintf (line, sizeof (line), "  warning: radix %zu uses the O(radix^2) generic butterfly\n", largestGenericRadix);
+            text += line;
+        }
+
+        return text;
+    }
+};
+
+#if FFTPP_INSTRUMENTATION
+//==============================================================================
+// Timestamp counter where the CPU has a cheap one, nanoseconds otherwise
+static inline uint64_t fftpp_cycles() noexcept
+{
+ #if defined (_MSC_VER) || defined (__x86_64__) || defined (__i386__)
+    return __rdtsc();
+ #elif defined (__aarch64__)
+    uint64_t ticks;
+    asm volatile ("mrs %0, cntvct_el0" : "=r" (ticks));
+    return ticks;
+ #else
+    return (uint64_t) std::chrono::duration_cast<std::chrono::nanoseconds> (std::chrono::steady_clock::now().time_since_epoch()).count();
+ #endif
+}
+
+// Cycles and calls per stage, indexed like FFTPlanStats::stages
+struct FFTProfile
+{
+    struct Counter { uint64_t cycles = 0, calls = 0; };
+
+    Counter stages[32];
+    Counter permutation;    // precomputed input gather
+    Counter realSplit;      // FFTReal pre/post-processing pass
+    Counter transforms;     // whole forward/inverse calls
+};
+
+class FFTProfileScope
+{
+public:
+    FFTProfileScope (FFTProfile::Counter& c) noexcept
+      : counter (c), start (fftpp_cycles()) {}
+
+    ~FFTProfileScope() noexcept
+    {
+        counter.cycles += fftpp_cycles() - start;
+        ++counter.calls;
+    }
+
+private:
+    FFTProfile::Counter& counter;
+    const uint64_t start;
+};
+
+ #define FFTPP_PROFILE_SCOPE(counter)  FFTProfileScope fftppProfileScope (counter)
+#else
+ #define FFTPP_PROFILE_SCOPE(counter)
+#endif
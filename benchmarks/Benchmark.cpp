@@ -0,0 +1,409 @@
+/*
+MIT License
+
+Copyright (c) 2024 Ragnar Hrafnkelsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Performance suite for FFTComplex and FFTReal.
+//
+//   g++ -std=c++17 -O2 -I. benchmarks/Benchmark.cpp -o benchmark
+//   ./benchmark [--filter=<substring>] [--min-time=<ms>] [--repetitions=<n>]
+//               [--json=<file>] [--quick] [--hugepages] [--perf-counters]
+//               [--prime-factor] [--split-radix]
+//
+// Every case is run warm (same buffers every iteration) and cold (cycling
+// through enough buffers to overflow the last level cache). Results report
+// ns/op, MFLOPS by the 5 N log2 N convention (2.5 N log2 N for real input),
+// the plan's own flop estimate and the input + output bytes per second.
+//
+// With --perf-counters each measurement is followed by a second run of the
+// same iteration count under Linux hardware counters, reported per transform
+// (cycles, instructions, L1D/LLC/dTLB read misses). Counters the CPU or VM
+// doesn't expose are left out.
+//
+// --prime-factor adds FFTComplex cases for the mixed radix sizes planned with
+// FFTOptions::Decomposition::primeFactor, suffixed +pfa, and --split-radix
+// the powers of two planned with Decomposition::splitRadix, suffixed +split.
+//
+// benchmarks/compare.py runs this binary with repetitions, stores the JSON as a
+// baseline and flags statistically significant regressions between two runs.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "../FFTReal.h"
+#include "PerfCounters.h"
+
+//==============================================================================
+struct BenchmarkSettings
+{
+    std::string filter, jsonPath;
+    double minTimeMs = 100;
+    int repetitions = 1;
+    bool quick = false, hugePages = false, perfCounters = false, primeFactor = false, splitRadix = false;
+};
+
+struct BenchmarkResult
+{
+    std::string name;
+    int repetition;
+    size_t iterations;
+    double nsPerOp, mflops, planFlops, bytesPerSecond;
+    std::array<double, PerfCounters::numEvents> counters; // per transform, negative if not measured
+};
+
+// Buffers above this total are assumed to be out of cache for cold runs
+static constexpr size_t coldBytes = (size_t) 64 << 20;
+
+//==============================================================================
+template <typename T>
+static T sampleValue (double x)
+{
+    if constexpr (fftpp_is_integral<T>)
+        return (T) (x * (1 << 28));
+    else
+        return (T) x;
+}
+
+template <typename T>
+static void fillRandom (std::vector<T>& buffer, std::mt19937& rng)
+{
+    std::uniform_real_distribution<double> dist (-1.0, 1.0);
+
+    for (auto& x : buffer)
+        x = sampleValue<T> (dist (rng));
+}
+
+// Times run (copy) with calibrated iteration counts until minTimeMs elapses
+static std::pair<size_t, double> measure (const std::function<void (size_t)>& run, double minTimeMs)
+{
+    using Clock = std::chrono::steady_clock;
+
+    size_t iterations = 1;
+
+    for (;;)
+    {
+        const auto start = Clock::now();
+
+        for (size_t i = 0; i < iterations; ++i)
+            run (i);
+
+        const auto elapsed = std::chrono::duration<double, std::nano> (Clock::now() - start).count();
+
+        if (elapsed >= minTimeMs * 1e6 || iterations >= ((size_t) 1 << 30))
+            return { iterations, elapsed / (double) iterations };
+
+        const auto target = minTimeMs * 1e6 * 1.2 / std::max (elapsed, 1.0);
+        iterations = (size_t) std::ceil ((double) iterations * std::min (std::max (target, 2.0), 100.0));
+    }
+}
+
+//==============================================================================
+class BenchmarkRunner
+{
+public:
+    BenchmarkRunner (const BenchmarkSettings& s) : settings (s)
+    {
+        if (settings.perfCounters)
+        {
+            counters = std::make_unique<PerfCounters>();
+
+            if (! counters->isAnyAvailable())
+                std::fprintf (stderr, "no hardware performance counters available, reporting timings only\n");
+        }
+    }
+
+    template <typename T, typename Allocator = FFTAlignedAllocator<std::complex<T>>>
+    void complexCases (const char* typeName, size_t size, const char* variant = "", const FFTOptions& options = {})
+    {
+        const auto prefix = std::string ("FFTComplex<") + typeName + ">" + variant;
+
+        if (! wanted (prefix, size))
+            return;
+
+        FFTComplex<T, Allocator> fft (size, options);
+        const auto flops = 5.0 * size * std::log2 ((double) std::max<size_t> (size, 2));
+        const auto bytes = 2.0 * size * sizeof (std::complex<T>);
+
+        for (auto cold : { false, true })
+        {
+            std::mt19937 rng (size);
+            const auto numBuffers = cold ? std::max<size_t> (1, coldBytes / (size_t) bytes) : 1;
+
+            std::vector<std::vector<std::complex<T>>> inputs (numBuffers), outputs (numBuffers);
+
+            for (size_t b = 0; b < numBuffers; ++b)
+            {
+                std::vector<T> samples (size * 2);
+                fillRandom (samples, rng);
+                inputs[b].assign (reinterpret_cast<std::complex<T>*> (samples.data()),
+                                  reinterpret_cast<std::complex<T>*> (samples.data()) + size);
+                outputs[b].resize (size);
+            }
+
+            add (prefix + "/forward/" + std::to_string (size) + (cold ? "/cold" : "/warm"), flops, fft.getStats().flops, bytes,
+                 [&] (size_t i) { auto b = i % numBuffers; fft.forward (reinterpret_cast<const T*> (inputs[b].data()), outputs[b].data()); });
+
+            add (prefix + "/inverse/" + std::to_string (size) + (cold ? "/cold" : "/warm"), flops, fft.getStats().flops, bytes,
+                 [&] (size_t i) { auto b = i % numBuffers; fft.inverse (inputs[b].data(), reinterpret_cast<T*> (outputs[b].data())); });
+        }
+    }
+
+    template <typename T, typename Allocator = FFTAlignedAllocator<std::complex<T>>>
+    void realCases (const char* typeName, size_t size, const char* allocatorName = "")
+    {
+        const auto prefix = std::string ("FFTReal<") + typeName + ">" + allocatorName;
+
+        if (size % 4 != 0 || ! wanted (prefix, size))
+            return;
+
+        FFTReal<T, Allocator> fft (size);
+        const auto flops = 2.5 * size * std::log2 ((double) size);
+        const auto bytes = size * sizeof (T) + (size / 2 + 1) * sizeof (std::complex<T>);
+
+        for (auto cold : { false, true })
+        {
+            std::mt19937 rng (size);
+            const auto numBuffers = cold ? std::max<size_t> (1, coldBytes / bytes) : 1;
+
+            std::vector<std::vector<T>> timeBuffers (numBuffers);
+            std::vector<std::vector<std::complex<T>>> freqBuffers (numBuffers);
+
+            for (size_t b = 0; b < numBuffers; ++b)
+            {
+                timeBuffers[b].resize (size);
+                fillRandom (timeBuffers[b], rng);
+                freqBuffers[b].resize (size / 2 + 1);
+                fft.forward (timeBuffers[b].data(), freqBuffers[b].data());
+            }
+
+            add (prefix + "/forward/" + std::to_string (size) + (cold ? "/cold" : "/warm"), flops, fft.getStats().flops, (double) bytes,
+                 [&] (size_t i) { auto b = i % numBuffers; fft.forward (timeBuffers[b].data(), freqBuffers[b].data()); });
+
+            add (prefix + "/inverse/" + std::to_string (size) + (cold ? "/cold" : "/warm"), flops, fft.getStats().flops, (double) bytes,
+                 [&] (size_t i) { auto b = i % numBuffers; fft.inverse (freqBuffers[b].data(), timeBuffers[b].data()); });
+        }
+    }
+
+    void writeJson() const
+    {
+        auto* file = std::fopen (settings.jsonPath.c_str(), "w");
+
+        if (file == nullptr)
+        {
+            std::fprintf (stderr, "can't write %s\n", settings.jsonPath.c_str());
+            return;
+        }
+
+        std::fprintf (file, "{\n  \"context\": {\n    \"library\": \"fft++\",\n    \"repetitions\": %d,\n    \"min_time_ms\": %g\n  },\n  \"benchmarks\": [",
+                      settings.repetitions, settings.minTimeMs);
+
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const auto& r = results[i];
+            std::fprintf (file, "%s\n    {\"name\": \"%s\", \"run_type\": \"iteration\", \"repetition_index\": %d, \"iterations\": %zu, "
+                                "\"real_time\": %.3f, \"time_unit\": \"ns\", \"mflops\": %.3f, \"plan_flops\": %.0f, \"bytes_per_second\": %.0f",
+                          i == 0 ? "" : ",", r.name.c_str(), r.repetition, r.iterations, r.nsPerOp, r.mflops, r.planFlops, r.bytesPerSecond);
+
+            for (int e = 0; e < PerfCounters::numEvents; ++e)
+                if (r.counters[(size_t) e] >= 0)
+                    std::fprintf (file, ", \"%s\": %.2f", PerfCounters::getName (e), r.counters[(size_t) e]);
+
+            std::fprintf (file, "}");
+        }
+
+        std::fprintf (file, "\n  ]\n}\n");
+        std::fclose (file);
+    }
+
+private:
+    bool wanted (const std::string& prefix, size_t size) const
+    {
+        if (settings.filter.empty())
+            return true;
+
+        // Match on any part of the full name, e.g. "FFTReal<float>/forward/1024"
+        for (auto* direction : { "/forward/", "/inverse/" })
+            for (auto* cache : { "/warm", "/cold" })
+                if ((prefix + direction + std::to_string (size) + cache).find (settings.filter) != std::string::npos)
+                    return true;
+
+        return false;
+    }
+
+    void add (const std::string& name, double flops, double planFlops, double bytes, const std::function<void (size_t)>& run)
+    {
+        if (! settings.filter.empty() && name.find (settings.filter) == std::string::npos)
+            return;
+
+        run (0);
+
+        for (int rep = 0; rep < settings.repetitions; ++rep)
+        {
+            const auto [iterations, ns] = measure (run, settings.minTimeMs);
+            BenchmarkResult result { name, rep, iterations, ns, flops / ns * 1e3, planFlops, bytes / ns * 1e9, {} };
+            result.counters.fill (-1.0);
+
+            std::printf ("%-52s %12.1f ns %10.1f MFLOPS %10.1f MB/s %12zu iterations",
+                         name.c_str(), ns, result.mflops, result.bytesPerSecond * 1e-6, iterations);
+
+            if (counters != nullptr && counters->isAnyAvailable())
+            {
+                counters->start();
+
+                for (size_t i = 0; i < iterations; ++i)
+                    run (i);
+
+                counters->stop();
+
+                result.counters = counters->read();
+
+                for (auto& value : result.counters)
+                    if (value >= 0)
+                        value /= (double) iterations;
+
+                const auto& c = result.counters;
+
+                if (c[PerfCounters::cycles] > 0 && c[PerfCounters::instructions] >= 0)
+                    std::printf ("  IPC %.2f", c[PerfCounters::instructions] / c[PerfCounters::cycles]);
+
+                for (int e = PerfCounters::l1dMisses; e < PerfCounters::numEvents; ++e)
+                    if (c[(size_t) e] >= 0)
+                        std::printf ("  %s %.1f", PerfCounters::getName (e), c[(size_t) e]);
+            }
+
+            std::printf ("\n");
+            std::fflush (stdout);
+
+            results.push_back (result);
+        }
+    }
+
+    const BenchmarkSettings settings;
+    std::unique_ptr<PerfCounters> counters;
+    std::vector<BenchmarkResult> results;
+};
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    BenchmarkSettings settings;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg (argv[i]);
+        const auto value = arg.substr (arg.find ('=') + 1);
+
+        if      (arg.rfind ("--filter=", 0) == 0)      settings.filter = value;
+        else if (arg.rfind ("--json=", 0) == 0)        settings.jsonPath = value;
+        else if (arg.rfind ("--min-time=", 0) == 0)    settings.minTimeMs = std::stod (value);
+        else if (arg.rfind ("--repetitions=", 0) == 0) settings.repetitions = std::max (1, std::stoi (value));
+        else if (arg == "--quick")                     settings.quick = true;
+        else if (arg == "--hugepages")                 settings.hugePages = true;
+        else if (arg == "--perf-counters")             settings.perfCounters = true;
+        else if (arg == "--prime-factor")              settings.primeFactor = true;
+        else if (arg == "--split-radix")               settings.splitRadix = true;
+        else
+        {
+            std::fprintf (stderr, "usage: %s [--filter=<substring>] [--min-time=<ms>] [--repetitions=<n>] [--json=<file>] [--quick] [--hugepages] [--perf-counters] [--prime-factor] [--split-radix]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    if (settings.quick)
+        settings.minTimeMs = std::min (settings.minTimeMs, 5.0);
+
+    std::vector<size_t> powersOfTwo { 64, 256, 1024, 4096, 16384, 65536, 262144 };
+    std::vector<size_t> mixedRadix  { 48, 360, 1000, 6000, 48000 };
+    std::vector<size_t> primes      { 17, 127, 1009 };
+
+    if (settings.quick)
+    {
+        powersOfTwo = { 64, 1024 };
+        mixedRadix  = { 360 };
+        primes      = { 17 };
+    }
+
+    std::vector<size_t> sizes;
+    sizes.insert (sizes.end(), powersOfTwo.begin(), powersOfTwo.end());
+    sizes.insert (sizes.end(), mixedRadix.begin(), mixedRadix.end());
+    sizes.insert (sizes.end(), primes.begin(), primes.end());
+
+    BenchmarkRunner runner (settings);
+
+    for (auto size : sizes)
+    {
+        runner.complexCases<float>   ("float",   size);
+        runner.complexCases<double>  ("double",  size);
+        runner.complexCases<int32_t> ("int32",   size);
+        runner.realCases<float>      ("float",   size);
+        runner.realCases<double>     ("double",  size);
+        runner.realCases<int32_t>    ("int32",   size);
+    }
+
+    // Huge page backed plans, where the tables span many 4 KiB pages
+    if (settings.hugePages)
+    {
+        for (auto size : { (size_t) 1 << 20, (size_t) 1 << 22 })
+        {
+            runner.complexCases<float> ("float", size);
+            runner.complexCases<float, FFTHugePageAllocator<std::complex<float>>> ("float", size, "+hugepages");
+        }
+    }
+
+    if (settings.primeFactor)
+    {
+        FFTOptions options;
+        options.decomposition = FFTOptions::Decomposition::primeFactor;
+
+        for (auto size : mixedRadix)
+        {
+            runner.complexCases<float>   ("float",  size, "+pfa", options);
+            runner.complexCases<double>  ("double", size, "+pfa", options);
+            runner.complexCases<int32_t> ("int32",  size, "+pfa", options);
+        }
+    }
+
+    if (settings.splitRadix)
+    {
+        FFTOptions options;
+        options.decomposition = FFTOptions::Decomposition::splitRadix;
+
+        for (auto size : powersOfTwo)
+        {
+            runner.complexCases<float>   ("float",  size, "+split", options);
+            runner.complexCases<double>  ("double", size, "+split", options);
+            runner.complexCases<int32_t> ("int32",  size, "+split", options);
+        }
+    }
+
+    if (! settings.jsonPath.empty())
+        runner.writeJson();
+
+    return 0;
+}
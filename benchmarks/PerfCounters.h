@@ -0,0 +1,154 @@
+/*
+MIT License
+
+Copyright (c) 2024 Ragnar Hrafnkelsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#if defined (__linux__)
+ #include <linux/perf_event.h>
+ #include <sys/ioctl.h>
+ #include <sys/syscall.h>
+ #include <unistd.h>
+#endif
+
+// Hardware counters for the calling thread, read with perf_event_open. Each
+// event is opened on its own so a CPU or VM lacking one still reports the
+// rest, and counts are scaled up if the kernel had to multiplex them.
+class PerfCounters
+{
+public:
+    //==========================================================================
+    enum Event { cycles, instructions, l1dMisses, llcMisses, dtlbMisses, numEvents };
+
+    static const char* getName (int event) noexcept
+    {
+        static const char* const names[] = { "cycles", "instructions", "l1d_misses", "llc_misses", "dtlb_misses" };
+        return names[event];
+    }
+
+    PerfCounters()
+    {
+        fds.fill (-1);
+
+       #if defined (__linux__)
+        const uint64_t readMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+
+        open (cycles,       PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        open (instructions, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        open (l1dMisses,    PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | readMiss);
+        open (llcMisses,    PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        open (dtlbMisses,   PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB | readMiss);
+       #endif
+    }
+
+    ~PerfCounters()
+    {
+       #if defined (__linux__)
+        for (auto fd : fds)
+            if (fd >= 0)
+                close (fd);
+       #endif
+    }
+
+    PerfCounters (const PerfCounters&) = delete;
+    PerfCounters& operator= (const PerfCounters&) = delete;
+
+    bool isAvailable (int event) const noexcept   { return fds[(size_t) event] >= 0; }
+
+    bool isAnyAvailable() const noexcept
+    {
+        for (int e = 0; e < numEvents; ++e)
+            if (isAvailable (e))
+                return true;
+
+        return false;
+    }
+
+    void start() noexcept
+    {
+       #if defined (__linux__)
+        for (auto fd : fds)
+            if (fd >= 0)
+                ioctl (fd, PERF_EVENT_IOC_RESET, 0);
+
+        for (auto fd : fds)
+            if (fd >= 0)
+                ioctl (fd, PERF_EVENT_IOC_ENABLE, 0);
+       #endif
+    }
+
+    void stop() noexcept
+    {
+       #if defined (__linux__)
+        for (auto fd : fds)
+            if (fd >= 0)
+                ioctl (fd, PERF_EVENT_IOC_DISABLE, 0);
+       #endif
+    }
+
+    // Counts between start() and stop(), negative for unavailable events
+    std::array<double, numEvents> read() const noexcept
+    {
+        std::array<double, numEvents> values;
+        values.fill (-1.0);
+
+       #if defined (__linux__)
+        for (size_t e = 0; e < values.size(); ++e)
+        {
+            uint64_t data[3] = {}; // value, time enabled, time running
+
+            if (fds[e] < 0 || ::read (fds[e], data, sizeof (data)) != (ssize_t) sizeof (data))
+                continue;
+
+            values[e] = data[2] > 0 ? (double) data[0] * ((double) data[1] / (double) data[2]) : 0.0;
+        }
+       #endif
+
+        return values;
+    }
+
+private:
+    //==========================================================================
+   #if defined (__linux__)
+    void open (Event event, uint32_t type, uint64_t config) noexcept
+    {
+        perf_event_attr attr;
+        std::memset (&attr, 0, sizeof (attr));
+        attr.size = sizeof (attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        fds[(size_t) event] = (int) syscall (__NR_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+   #endif
+
+    std::array<int, numEvents> fds;
+};
@@ -0,0 +1,213 @@
+#!/usr/bin/env python3
+#
+# MIT License
+#
+# Copyright (c) 2024 Ragnar Hrafnkelsson
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files(the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions :
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+"""Performance regression gate for the FFTComplex / FFTReal benchmark suite.
+
+    # record a baseline and a contender (each case repeated, JSON output)
+    benchmarks/compare.py run --benchmark=./benchmark --repetitions=10 --out=baseline.json
+    benchmarks/compare.py run --benchmark=./benchmark --repetitions=10 --out=contender.json
+
+    # compare them, exit status 1 if anything regressed
+    benchmarks/compare.py compare baseline.json contender.json --threshold=5
+
+A case regresses when its median time grows by more than --threshold percent
+and the difference is significant: the Mann-Whitney U test over the
+repetitions rejects "same distribution" at --alpha. Each side's median also
+gets a distribution-free confidence interval from order statistics, so the
+report shows how noisy the measurement was. A case is only tested when its
+repetition counts could reach --alpha at all: even fully separated runs give
+p ~ 0.08 at 3 vs 3, so the default alpha of 0.05 needs at least 4 vs 4, and
+cases with fewer are reported but never flagged.
+"""
+
+import argparse
+import json
+import math
+import subprocess
+import sys
+
+
+#==============================================================================
+def load(path):
+    """Returns {name: [real_time, ...]} in ns per transform."""
+    with open(path) as f:
+        data = json.load(f)
+
+    runs = {}
+    for b in data.get("benchmarks", []):
+        if b.get("run_type", "iteration") != "iteration":
+            continue
+        runs.setdefault(b["name"], []).append(float(b["real_time"]))
+    return runs
+
+
+def median(values):
+    s = sorted(values)
+    n = len(s)
+    return s[n // 2] if n % 2 else 0.5 * (s[n // 2 - 1] + s[n // 2])
+
+
+def normal_cdf(z):
+    return 0.5 * math.erfc(-z / math.sqrt(2))
+
+
+def median_interval(values, confidence):
+    """Order statistic interval [s[lo], s[hi]] covering the median with at
+    least the requested confidence, from the Binomial(n, 1/2) distribution.
+    Falls back to the full range when n is too small to reach it."""
+    s = sorted(values)
+    n = len(s)
+    pmf = [math.comb(n, k) / 2.0 ** n for k in range(n + 1)]
+
+    for lo in range((n - 1) // 2, -1, -1):
+        hi = n - 1 - lo
+        if sum(pmf[lo + 1:hi + 1]) >= confidence:
+            return s[lo], s[hi]
+    return s[0], s[-1]
+
+
+def mann_whitney_p(a, b):
+    """Two-sided p-value of the Mann-Whitney U test, normal approximation
+    with tie correction."""
+    n1, n2 = len(a), len(b)
+    pooled = sorted([(v, 0) for v in a] + [(v, 1) for v in b])
+
+    ranks, ties, i = [0.0] * len(pooled), 0.0, 0
+    while i < len(pooled):
+        j = i
+        while j + 1 < len(pooled) and pooled[j + 1][0] == pooled[i][0]:
+            j += 1
+        for k in range(i, j + 1):
+            ranks[k] = 0.5 * (i + j) + 1
+        t = j - i + 1
+        ties += t ** 3 - t
+        i = j + 1
+
+    r1 = sum(r for r, (_, side) in zip(ranks, pooled) if side == 0)
+    u = r1 - n1 * (n1 + 1) / 2
+    n = n1 + n2
+    variance = n1 * n2 / 12.0 * ((n + 1) - ties / (n * (n - 1)))
+    if variance <= 0:
+        return 1.0
+
+    z = (abs(u - n1 * n2 / 2.0) - 0.5) / math.sqrt(variance)
+    return min(1.0, 2 * (1 - normal_cdf(max(z, 0.0))))
+
+
+def smallest_p(n1, n2):
+    """Lowest p-value the U test can return for n1 vs n2 repetitions, that of
+    two fully separated samples."""
+    return mann_whitney_p(range(n1), range(n1, n1 + n2))
+
+
+#==============================================================================
+def run(args):
+    command = [args.benchmark, "--json=" + args.out, "--repetitions=%d" % args.repetitions]
+    if args.filter:
+        command.append("--filter=" + args.filter)
+    if args.min_time:
+        command.append("--min-time=%g" % args.min_time)
+    if args.quick:
+        command.append("--quick")
+    if args.hugepages:
+        command.append("--hugepages")
+
+    print(" ".join(command), file=sys.stderr)
+    return subprocess.call(command)
+
+
+def compare(args):
+    baseline, contender = load(args.baseline), load(args.contender)
+    names = [n for n in baseline if n in contender]
+    missing = sorted(set(baseline) ^ set(contender))
+
+    if not names:
+        print("no benchmarks in common", file=sys.stderr)
+        return 2
+
+    width = max(len(n) for n in names)
+    print("%-*s %12s %25s %12s %25s %8s %7s" % (width, "benchmark", "base ns", "base %d%% CI" % round(args.confidence * 100),
+                                               "new ns", "new CI", "change", "p"))
+    regressions, improvements = [], []
+
+    for name in names:
+        a, b = baseline[name], contender[name]
+        ma, mb = median(a), median(b)
+        la, ha = median_interval(a, args.confidence)
+        lb, hb = median_interval(b, args.confidence)
+        change = (mb / ma - 1) * 100 if ma > 0 else 0.0
+        enough = smallest_p(len(a), len(b)) < args.alpha
+        p = mann_whitney_p(a, b) if enough else float("nan")
+        significant = enough and p < args.alpha
+
+        verdict = ""
+        if significant and change > args.threshold:
+            verdict = "REGRESSION"
+            regressions.append(name)
+        elif significant and change < -args.threshold:
+            verdict = "improvement"
+            improvements.append(name)
+        elif not enough:
+            verdict = "(too few repetitions)"
+
+        print("%-*s %12.1f %25s %12.1f %25s %+7.1f%% %7.3f  %s" % (width, name, ma, "[%.1f, %.1f]" % (la, ha),
+                                                                 mb, "[%.1f, %.1f]" % (lb, hb), change, p, verdict))
+
+    for name in missing:
+        print("%-*s only in %s" % (width, name, args.baseline if name in baseline else args.contender))
+
+    print("\n%d compared, %d regressed, %d improved (threshold %g%%, alpha %g)"
+          % (len(names), len(regressions), len(improvements), args.threshold, args.alpha))
+    return 1 if regressions else 0
+
+
+#==============================================================================
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    r = commands.add_parser("run", help="run the benchmark binary and store its JSON output")
+    r.add_argument("--benchmark", default="./benchmark", help="path to the compiled benchmarks/Benchmark.cpp")
+    r.add_argument("--out", required=True, help="JSON file to write")
+    r.add_argument("--repetitions", type=int, default=10)
+    r.add_argument("--filter", default="")
+    r.add_argument("--min-time", type=float, default=0, help="ms per repetition, 0 keeps the runner's default")
+    r.add_argument("--quick", action="store_true")
+    r.add_argument("--hugepages", action="store_true")
+    r.set_defaults(func=run)
+
+    c = commands.add_parser("compare", help="compare two JSON runs")
+    c.add_argument("baseline")
+    c.add_argument("contender")
+    c.add_argument("--threshold", type=float, default=5.0, help="minimum slowdown in percent to flag")
+    c.add_argument("--alpha", type=float, default=0.05, help="significance level of the U test")
+    c.add_argument("--confidence", type=float, default=0.95, help="coverage of the median intervals")
+    c.set_defaults(func=compare)
+
+    args = parser.parse_args()
+    sys.exit(args.func(args))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,667 @@
+/*
+MIT License
+
+Copyright (c) 2024 Ragnar Hrafnkelsson
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files(the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and /or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions :
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+// Correctness checks of FFTComplex and FFTReal against a naive DFT.
+//
+//   g++ -std=c++17 -O2 -I. tests/DFTCheck.cpp -o dftcheck
+//   ./dftcheck
+//
+// Inputs are uniform in [-1, 1). Forward errors are taken against the DFT
+// divided by sqrt (N), so every bin has unit RMS, and round trip errors
+// against the input after dividing by N, both also divided by the scales
+// FFTOptions::normalization asks for. Every case over its type's tolerance
+// is printed, and the exit code is non-zero if any failed.
+//
+// int32_t plans are checked in Q31, their inputs scaled by 2^31 and their
+// outputs back down. Fixed point scales down by the radix at every stage, so
+// forward gives the DFT divided by N and the round trip the input divided
+// by N.
+//
+// Strided cases transform one channel of an interleaved buffer and also
+// fail if anything between its samples was written.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../FFTReal.h"
+
+using C = std::complex<double>;
+
+static std::vector<C> dft (const std::vector<C>& x)
+{
+    const auto n = x.size();
+    std::vector<C> y (n), w (n);
+
+    for (size_t i = 0; i < n; ++i)
+        w[i] = std::polar (1.0, -2 * M_PI * (double) i / (double) n);
+
+    for (size_t k = 0; k < n; ++k)
+        for (size_t j = 0; j < n; ++j)
+            y[k] += x[j] * w[j * k % n];
+
+    return y;
+}
+
+static std::string describe (const FFTOptions& options)
+{
+    static const char* const decompositions[] = { "mixedRadix", "primeFactor", "splitRadix" };
+    static const char* const permutations[]   = { "automatic", "recursive", "precomputed" };
+
+    return std::string (decompositions[(int) options.decomposition]) + "/" + permutations[(int) options.permutation];
+}
+
+// Fixed point rounds to 2^-31 at every stage, which shows up as steps of
+// sqrt (N) 2^-31 in the forward error and N 2^-31 in the round trip error
+// once scaled back up. Both stay within a few steps.
+template <typename T>
+static double tolerance (size_t n, bool roundTrip = false)
+{
+    if constexpr (std::is_integral_v<T>)
+        return 32 * (roundTrip ? (double) n : std::sqrt ((double) n)) / 2147483648.0;
+
+    return std::is_same_v<T, float> ? 1e-5 : 1e-12;
+}
+
+struct Errors
+{
+    double forward = 0, roundTrip = 0;
+};
+
+// Full scale of T, 2^31 for Q31
+template <typename T>
+static constexpr double unit = std::is_integral_v<T> ? 2147483648.0 : 1.0;
+
+template <typename T>
+static double toDouble (T x)
+{
+    return (double) x / unit<T>;
+}
+
+template <typename T>
+static C toDouble (std::complex<T> x)
+{
+    return { toDouble (x.real()), toDouble (x.imag()) };
+}
+
+// What forward and a forward/inverse round trip multiply by
+template <typename T>
+static double forwardScale (const FFTOptions& options, size_t n)
+{
+    return std::is_integral_v<T> ? 1.0 / (double) n : options.getScale (n, false);
+}
+
+template <typename T>
+static double roundTripScale (const FFTOptions& options, size_t n)
+{
+    return std::is_integral_v<T> ? 1.0 / (double) n : (double) n * options.getScale (n, false) * options.getScale (n, true);
+}
+
+// Like std::max, but a NaN error sticks
+static double worse (double error, double e)
+{
+    return std::isnan (error) || e <= error ? error : e;
+}
+
+// Fills a strided buffer's gaps, which untouched() then checks
+template <typename T>
+static constexpr T gap = (T) 12345;
+
+template <typename T>
+static bool untouched (const std::vector<T>& buffer, size_t channel, size_t stride)
+{
+    for (size_t i = 0; i < buffer.size(); ++i)
+        if (i % stride != channel && buffer[i] != gap<T>)
+            return false;
+
+    return true;
+}
+
+//==============================================================================
+class DFTCheck
+{
+public:
+    int run()
+    {
+        for (auto decomposition : { FFTOptions::Decomposition::mixedRadix, FFTOptions::Decomposition::primeFactor,
+                                    FFTOptions::Decomposition::splitRadix })
+        {
+            for (auto permutation : { FFTOptions::Permutation::recursive, FFTOptions::Permutation::precomputed })
+            {
+                FFTOptions options;
+                options.decomposition = decomposition;
+                options.permutation = permutation;
+
+                checkTypes (options);
+            }
+        }
+
+        std::printf ("%d of %d cases failed\n", failures, cases);
+        return failures != 0 ? 1 : 0;
+    }
+
+private:
+    //==========================================================================
+    template <typename T>
+    void checkType (const FFTOptions& options, const char* typeName)
+    {
+        // Radix 11 and 13 as leaves, stages and prime-factor splits, and
+        // powers of two for split radix
+        for (size_t n : { 11, 13, 16, 22, 26, 64, 121, 143, 169, 176, 208, 1024, 1331, 1716, 4096, 4620 })
+            report<T> ("FFTComplex<" + std::string (typeName) + ">", n, options, complexError<T> (n, options));
+
+        // From 1024 up the inner plans start with a radix-4 stage and fuse
+        // the forward split into it
+        for (size_t n : { 44, 52, 64, 572, 1024, 2048, 3432, 8192, 9240 })
+            report<T> ("FFTReal<" + std::string (typeName) + ">", n, options, realError<T> (n, options));
+
+        // Fixed point shares the rest with floating point, bar the
+        // normalization it doesn't have
+        if constexpr (std::is_floating_point_v<T>)
+        {
+            checkStrides<T> (options, typeName);
+            checkOverlapAdd<T> (options, typeName);
+            checkNormalization<T> (options, typeName);
+            checkWindows<T> (options, typeName);
+            checkInPlace<T> (options, typeName);
+        }
+    }
+
+    // Round trips through inverseInPlace, to contiguous and strided output
+    template <typename T>
+    void checkInPlace (FFTOptions options, const char* typeName)
+    {
+        options.stridedOutput = true;
+
+        for (size_t outStride : { 1, 2 })
+            for (size_t n : { 52, 572, 1024, 2048 })
+                report ("FFTReal<" + std::string (typeName) + "> inverseInPlace, out stride " + std::to_string (outStride),
+                        n, options, inPlaceError<T> (n, options, outStride), tolerance<T> (n));
+    }
+
+    // The cached window tables, and windowed forward transforms of strided
+    // input with them or, for Window::none, a random window
+    template <typename T>
+    void checkWindows (FFTOptions options, const char* typeName)
+    {
+        static const char* const names[] = { "random", "hann", "hamming", "blackmanHarris", "kaiser" };
+
+        for (auto window : { FFTOptions::Window::none, FFTOptions::Window::hann, FFTOptions::Window::hamming,
+                             FFTOptions::Window::blackmanHarris, FFTOptions::Window::kaiser })
+        {
+            options.window = window;
+            const auto name = "FFTReal<" + std::string (typeName) + "> " + names[(int) window] + " window";
+
+            for (size_t n : { 52, 572, 1024, 2048 })
+            {
+                report (name + ", forward", n, options, windowedError<T> (n, options), tolerance<T> (n));
+
+                if (window != FFTOptions::Window::none)
+                    report (name + ", table", n, options, windowTableError<T> (n, options), tolerance<T> (n));
+            }
+        }
+    }
+
+    // Scaled round trips, the real ones both with the split pass fused
+    // into the last stage (from 1024) and without
+    template <typename T>
+    void checkNormalization (FFTOptions options, const char* typeName)
+    {
+        static const char* const names[] = { "none", "inverse", "unitary", "custom" };
+
+        options.customScale = 0.375;
+
+        for (auto normalization : { FFTOptions::Normalization::inverse, FFTOptions::Normalization::unitary,
+                                    FFTOptions::Normalization::custom })
+        {
+            options.normalization = normalization;
+            const auto suffix = std::string ("> normalization ") + names[(int) normalization];
+
+            for (size_t n : { 13, 64, 1024, 1716 })
+                report<T> ("FFTComplex<" + std::string (typeName) + suffix, n, options, complexError<T> (n, options));
+
+            for (size_t n : { 52, 572, 1024, 3432 })
+                report<T> ("FFTReal<" + std::string (typeName) + suffix, n, options, realError<T> (n, options));
+        }
+    }
+
+    // One channel of interleaved input and output buffers, with the same and
+    // different strides each way, forward and inverse. The channel is below
+    // both strides.
+    template <typename T>
+    void checkStrides (FFTOptions options, const char* typeName)
+    {
+        struct Strides { size_t channel, in, out; };
+        static const Strides cases[] = { { 1, 2, 2 }, { 0, 3, 1 }, { 0, 1, 2 }, { 1, 3, 2 }, { 2, 4, 3 } };
+
+        options.stridedOutput = true;
+
+        for (const auto& strides : cases)
+        {
+            char name[64];
+
+            for (size_t n : { 13, 64, 143, 1024, 1716 })
+            {
+                std::snprintf (name, sizeof (name), "FFTComplex<%s> channel %zu strides %zu/%zu", typeName, strides.channel, strides.in, strides.out);
+                report (name, n, options, complexStridedError<T> (n, options, strides.channel, strides.in, strides.out, strides.in), tolerance<T> (n));
+            }
+
+            for (size_t n : { 52, 572, 1024, 2048 })
+            {
+                std::snprintf (name, sizeof (name), "FFTReal<%s> channel %zu strides %zu/%zu", typeName, strides.channel, strides.in, strides.out);
+                report (name, n, options, realStridedError<T> (n, options, strides.channel, strides.in, strides.out, strides.in), tolerance<T> (n));
+            }
+        }
+
+        // Without the workspace, strided output throws rather than running
+        // past the end of the plan's block; strided input needs none
+        options.stridedOutput = false;
+        const auto n = options.decomposition == FFTOptions::Decomposition::splitRadix ? 1024 : 1716;
+        const auto name = [&] (const char* plan, const char* what) { return plan + std::string ("<") + typeName + "> " + what; };
+
+        std::vector<std::complex<T>> complexData (2 * n);
+        std::vector<T> realData (4 * n);
+        FFTComplex<T> complexPlan (n, options);
+        FFTReal<T> realPlan (2 * n, options);
+
+        expectThrow (name ("FFTComplex", "forward, out stride 2"), n, options,
+                     [&] { complexPlan.forward (reinterpret_cast<const T*> (complexData.data()), complexData.data(), 1, 2); });
+        expectThrow (name ("FFTComplex", "inverse, out stride 2"), n, options,
+                     [&] { complexPlan.inverse (complexData.data(), reinterpret_cast<T*> (complexData.data()), 1, 2); });
+        expectThrow (name ("FFTReal", "inverse, out stride 2"), 2 * n, options,
+                     [&] { realPlan.inverse (complexData.data(), realData.data(), 1, 2); });
+
+        report (name ("FFTComplex", "in stride 2, no workspace"), n, options, complexStridedError<T> (n, options, 0, 2, 1, 1), tolerance<T> (n));
+        report (name ("FFTReal", "in stride 2, no workspace"), 2 * n, options, realStridedError<T> (2 * n, options, 0, 2, 1, 1), tolerance<T> (2 * n));
+    }
+
+    void checkTypes (const FFTOptions& options)
+    {
+        checkType<float> (options, "float");
+        checkType<double> (options, "double");
+        checkType<int32_t> (options, "int32_t");
+    }
+
+    // inverseAccumulate into a ring of random samples, from an offset that
+    // wraps around its end, without a window and with the plan's own
+    template <typename T>
+    void checkOverlapAdd (FFTOptions options, const char* typeName)
+    {
+        options.stridedOutput = true;
+
+        for (auto window : { FFTOptions::Window::none, FFTOptions::Window::hann })
+        {
+            options.window = window;
+            const auto name = "FFTReal<" + std::string (typeName) + "> inverseAccumulate" + (window != FFTOptions::Window::none ? ", hann" : "");
+
+            for (size_t n : { 52, 572, 1024, 2048 })
+                report (name, n, options, overlapAddError<T> (n, options), tolerance<T> (n));
+        }
+
+        // No workspace, nowhere to run the inverse
+        options.stridedOutput = false;
+        FFTReal<T> fft (1024, options);
+        std::vector<std::complex<T>> spectrum (513);
+        std::vector<T> ring (2048);
+
+        expectThrow ("FFTReal<" + std::string (typeName) + "> inverseAccumulate, no workspace", 1024, options,
+                     [&] { fft.inverseAccumulate (spectrum.data(), ring.data(), ring.size(), 100); });
+    }
+
+    template <typename T>
+    void report (const std::string& name, size_t n, const FFTOptions& options, const Errors& errors)
+    {
+        report (name + " forward", n, options, errors.forward, tolerance<T> (n));
+        report (name + " round trip", n, options, errors.roundTrip, tolerance<T> (n, true));
+    }
+
+    void report (const std::string& name, size_t n, const FFTOptions& options, double error, double limit)
+    {
+        char problem[64];
+        std::snprintf (problem, sizeof (problem), "error %g, tolerance %g", error, limit);
+        expect (error <= limit, name, n, options, problem);
+    }
+
+    template <typename Fn>
+    void expectThrow (const std::string& name, size_t n, const FFTOptions& options, Fn&& fn)
+    {
+        auto threw = false;
+
+        try
+        {
+            fn();
+        }
+        catch (const std::invalid_argument&)
+        {
+            threw = true;
+        }
+
+        expect (threw, name, n, options, "no std::invalid_argument");
+    }
+
+    void expect (bool passed, const std::string& name, size_t n, const FFTOptions& options, const char* problem)
+    {
+        ++cases;
+
+        if (! passed)
+        {
+            std::printf ("%s %zu %s: %s\n", name.c_str(), n, describe (options).c_str(), problem);
+            ++failures;
+        }
+    }
+
+    //==========================================================================
+    template <typename T>
+    T sample()
+    {
+        return (T) (uniform (random) * unit<T>);
+    }
+
+    template <typename T>
+    Errors complexError (size_t n, const FFTOptions& options)
+    {
+        std::vector<std::complex<T>> input (n), output (n), back (n);
+        std::vector<C> reference (n);
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            input[i] = { sample<T>(), sample<T>() };
+            reference[i] = toDouble (input[i]);
+        }
+
+        FFTComplex<T> fft (n, options);
+        fft.forward (reinterpret_cast<const T*> (input.data()), output.data());
+        fft.inverse (output.data(), reinterpret_cast<T*> (back.data()));
+
+        const auto expected = dft (reference);
+        const auto scale = forwardScale<T> (options, n);
+        const auto roundTrip = roundTripScale<T> (options, n);
+        Errors errors;
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            errors.forward   = worse (errors.forward, std::abs (toDouble (output[i]) / scale - expected[i]) / std::sqrt ((double) n));
+            errors.roundTrip = worse (errors.roundTrip, std::abs (toDouble (back[i]) / roundTrip - reference[i]));
+        }
+
+        return errors;
+    }
+
+    // Time samples at channel + i * inStride, bins at channel + k * outStride,
+    // the inverse reading the bins and writing the time samples back at
+    // backStride
+    template <typename T>
+    double complexStridedError (size_t n, const FFTOptions& options, size_t channel, size_t inStride, size_t outStride, size_t backStride)
+    {
+        std::vector<std::complex<T>> input (n * inStride, gap<T>), output (n * outStride, gap<T>), back (n * backStride, gap<T>);
+        std::vector<C> reference (n);
+
+        for (size_t i = 0; i < n; ++i)
+            reference[i] = input[channel + i * inStride] = { sample<T>(), sample<T>() };
+
+        FFTComplex<T> fft (n, options);
+        fft.forward (reinterpret_cast<const T*> (input.data() + channel), output.data() + channel, inStride, outStride);
+        fft.inverse (output.data() + channel, reinterpret_cast<T*> (back.data() + channel), outStride, backStride);
+
+        if (! untouched (output, channel, outStride) || ! untouched (back, channel, backStride))
+            return std::numeric_limits<double>::infinity();
+
+        const auto expected = dft (reference);
+        double error = 0;
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            error = worse (error, std::abs (C (output[channel + i * outStride]) - expected[i]) / std::sqrt ((double) n));
+            error = worse (error, std::abs (C (back[channel + i * backStride]) / (double) n - reference[i]));
+        }
+
+        return error;
+    }
+
+    template <typename T>
+    Errors realError (size_t n, const FFTOptions& options)
+    {
+        std::vector<T> input (n), back (n);
+        std::vector<std::complex<T>> output (n / 2 + 1);
+        std::vector<C> reference (n);
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            input[i] = sample<T>();
+            reference[i] = toDouble (input[i]);
+        }
+
+        FFTReal<T> fft (n, options);
+        fft.forward (input.data(), output.data());
+        fft.inverse (output.data(), back.data());
+
+        const auto expected = dft (reference);
+        const auto scale = forwardScale<T> (options, n);
+        const auto roundTrip = roundTripScale<T> (options, n);
+        Errors errors;
+
+        for (size_t i = 0; i <= n / 2; ++i)
+            errors.forward = worse (errors.forward, std::abs (toDouble (output[i]) / scale - expected[i]) / std::sqrt ((double) n));
+
+        for (size_t i = 0; i < n; ++i)
+            errors.roundTrip = worse (errors.roundTrip, std::abs (toDouble (back[i]) / roundTrip - reference[i].real()));
+
+        return errors;
+    }
+
+    template <typename T>
+    double realStridedError (size_t n, const FFTOptions& options, size_t channel, size_t inStride, size_t outStride, size_t backStride)
+    {
+        std::vector<T> input (n * inStride, gap<T>), back (n * backStride, gap<T>);
+        std::vector<std::complex<T>> output ((n / 2 + 1) * outStride, gap<T>);
+        std::vector<C> reference (n);
+
+        for (size_t i = 0; i < n; ++i)
+            reference[i] = input[channel + i * inStride] = sample<T>();
+
+        FFTReal<T> fft (n, options);
+        fft.forward (input.data() + channel, output.data() + channel, inStride, outStride);
+        fft.inverse (output.data() + channel, back.data() + channel, outStride, backStride);
+
+        if (! untouched (output, channel, outStride) || ! untouched (back, channel, backStride))
+            return std::numeric_limits<double>::infinity();
+
+        const auto expected = dft (reference);
+        double error = 0;
+
+        for (size_t i = 0; i <= n / 2; ++i)
+            error = worse (error, std::abs (C (output[channel + i * outStride]) - expected[i]) / std::sqrt ((double) n));
+
+        for (size_t i = 0; i < n; ++i)
+            error = worse (error, std::abs ((double) back[channel + i * backStride] / (double) n - reference[i].real()));
+
+        return error;
+    }
+
+    // Forward, then inverseInPlace out of the spectrum it overwrites
+    template <typename T>
+    double inPlaceError (size_t n, const FFTOptions& options, size_t outStride)
+    {
+        std::vector<T> input (n), back (n * outStride, gap<T>);
+        std::vector<std::complex<T>> spectrum (n / 2 + 1);
+
+        for (auto& x : input)
+            x = sample<T>();
+
+        FFTReal<T> fft (n, options);
+        fft.forward (input.data(), spectrum.data());
+        fft.inverseInPlace (spectrum.data(), back.data(), outStride);
+
+        if (! untouched (back, 0, outStride))
+            return std::numeric_limits<double>::infinity();
+
+        const auto roundTripScale = (double) n * options.getScale (n, false) * options.getScale (n, true);
+        double error = 0;
+
+        for (size_t i = 0; i < n; ++i)
+            error = worse (error, std::abs ((double) back[i * outStride] / roundTripScale - (double) input[i]));
+
+        return error;
+    }
+
+    // Sample i read from input[1 + 3 * i], the window from window[i]
+    template <typename T>
+    double windowedError (size_t n, const FFTOptions& options)
+    {
+        const size_t channel = 1, inStride = 3;
+
+        FFTReal<T> fft (n, options);
+        std::vector<T> input (n * inStride), randomWindow (n);
+        std::vector<std::complex<T>> output (n / 2 + 1);
+        std::vector<C> reference (n);
+
+        for (auto& w : randomWindow)
+            w = (T) (0.5 + 0.5 * uniform (random));
+
+        const auto* window = fft.getWindow() != nullptr ? fft.getWindow() : randomWindow.data();
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            input[channel + i * inStride] = sample<T>();
+            reference[i] = (double) input[channel + i * inStride] * (double) window[i];
+        }
+
+        fft.forward (input.data() + channel, window, output.data(), inStride);
+
+        const auto expected = dft (reference);
+        const auto forwardScale = options.getScale (n, false);
+        double error = 0;
+
+        for (size_t i = 0; i <= n / 2; ++i)
+            error = worse (error, std::abs (C (output[i]) / forwardScale - expected[i]) / std::sqrt ((double) n));
+
+        return error;
+    }
+
+    // Periodic windows, w[i] for i = 0..n-1 out of n + 1 symmetric points
+    template <typename T>
+    double windowTableError (size_t n, const FFTOptions& options)
+    {
+        const FFTReal<T> fft (n, options);
+        const auto* window = fft.getWindow();
+
+        // Power series of the zeroth order modified Bessel function
+        const auto i0 = [] (double x)
+        {
+            double sum = 0, term = 1;
+
+            for (int k = 1; sum + term != sum; ++k)
+            {
+                sum += term;
+                term *= x * x / (4.0 * k * k);
+            }
+
+            return sum;
+        };
+
+        double error = 0;
+
+        for (size_t i = 0; i < n; ++i)
+        {
+            const auto x = (double) i / (double) n;
+            const auto s = std::sin (M_PI * x);
+            double expected = 1;
+
+            switch (options.window)
+            {
+                case FFTOptions::Window::hann:    expected = s * s; break;
+                case FFTOptions::Window::hamming: expected = 0.08 + 0.92 * s * s; break;
+                case FFTOptions::Window::blackmanHarris:
+                    expected = 0.35875 - 0.48829 * std::cos (2 * M_PI * x) + 0.14128 * std::cos (4 * M_PI * x) - 0.01168 * std::cos (6 * M_PI * x);
+                    break;
+                case FFTOptions::Window::kaiser:
+                    expected = i0 (options.kaiserBeta * 2 * std::sqrt (x * (1 - x))) / i0 (options.kaiserBeta);
+                    break;
+                default: break;
+            }
+
+            error = worse (error, std::abs ((double) window[i] - expected));
+        }
+
+        return error;
+    }
+
+    // The spectrum is the DFT of random samples, so the inverse adds n times
+    // them, windowed, into ring[(offset + i) % ringSize]
+    template <typename T>
+    double overlapAddError (size_t n, const FFTOptions& options)
+    {
+        const auto ringSize = n + n / 2 + 3;
+        const auto offset = ringSize - n / 3;
+
+        std::vector<C> samples (n);
+        std::vector<T> ring (ringSize), before (ringSize);
+
+        for (auto& x : samples)
+            x = sample<T>();
+
+        for (auto& x : ring)
+            x = sample<T>();
+
+        const auto expected = dft (samples);
+        std::vector<std::complex<T>> spectrum (n / 2 + 1);
+
+        for (size_t k = 0; k <= n / 2; ++k)
+            spectrum[k] = std::complex<T> (expected[k]);
+
+        FFTReal<T> fft (n, options);
+        const auto* window = fft.getWindow();
+
+        before = ring;
+        fft.inverseAccumulate (spectrum.data(), ring.data(), ringSize, offset, window);
+
+        double error = 0;
+
+        for (size_t j = 0; j < ringSize; ++j)
+        {
+            const auto i = (j + ringSize - offset) % ringSize;
+            auto added = 0.0;
+
+            if (i < n)
+                added = samples[i].real() * (window != nullptr ? (double) window[i] : 1.0);
+
+            error = worse (error, std::abs ((double) ring[j] - (double) before[j] - (double) n * added) / (double) n);
+        }
+
+        return error;
+    }
+
+    std::mt19937 random { 1 };
+    std::uniform_real_distribution<double> uniform { -1, 1 };
+    int failures = 0, cases = 0;
+};
+
+int main()
+{
+    return DFTCheck().run();
+}